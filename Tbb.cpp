@@ -6,89 +6,26 @@
 #include <vector>
 #include <iomanip>
 #include <tbb/parallel_for.h>
-#include <tbb/concurrent_vector.h>
 #include <filesystem>
 #include <algorithm>
 #include <map>
 #include <numeric>
 
-#define _USE_MATH_DEFINES
-#include <math.h>
+#include "droplet_engine/pipeline.hpp"
+#include "droplet_engine/result_table.hpp"
+#include "droplet_engine/threading_policy.hpp"
 
 using namespace cv;
 using namespace std;
 using namespace std::chrono;
 namespace fs = std::filesystem;
-
-struct ContourMetrics {
-    double area_original;
-    double area_hull;
-    double area_ratio;
-    double circularity_original;
-    double circularity_hull;
-    double circularity_ratio;
-    vector<Point> contour;
-    vector<Point> hull;
-    long long process_time;
-};
-
-ContourMetrics calculate_contour_metrics(const vector<vector<Point>>& contours) {
-    ContourMetrics results;
-    if (contours.empty()) {
-        return results;
-    }
-
-    auto cnt = *max_element(contours.begin(), contours.end(),
-        [](const vector<Point>& c1, const vector<Point>& c2) {
-            return contourArea(c1) < contourArea(c2);
-        });
-
-    results.area_original = contourArea(cnt);
-    double perimeter_original = arcLength(cnt, true);
-    results.circularity_original = (2 * sqrt(M_PI * results.area_original)) / perimeter_original;
-
-    convexHull(cnt, results.hull);
-
-    results.area_hull = contourArea(results.hull);
-    double perimeter_hull = arcLength(results.hull, true);
-    results.circularity_hull = (2 * sqrt(M_PI * results.area_hull)) / perimeter_hull;
-
-    results.area_ratio = results.area_hull / results.area_original;
-    results.circularity_ratio = results.circularity_hull / results.circularity_original;
-
-    results.contour = cnt;
-
-    return results;
-}
-
-ContourMetrics process_image(const Mat& img, const Mat& background) {
-    Mat blur_img, blur_background, substract, binary, erode1, dilate1, dilate2, erode2, edge;
-
-    GaussianBlur(img, blur_img, Size(3, 3), 0);
-    GaussianBlur(background, blur_background, Size(3, 3), 0);
-
-    subtract(blur_background, blur_img, substract);
-    threshold(substract, binary, 10, 255, THRESH_BINARY);
-
-    Mat kernel = getStructuringElement(MORPH_CROSS, Size(3, 3));
-
-    erode(binary, erode1, kernel);
-    dilate(erode1, dilate1, kernel);
-    dilate(dilate1, dilate2, kernel);
-    erode(dilate2, erode2, kernel);
-
-    Canny(erode2, edge, 50, 150);
-
-    vector<vector<Point>> contours;
-    vector<Vec4i> hierarchy;
-    findContours(edge, contours, hierarchy, RETR_EXTERNAL, CHAIN_APPROX_NONE);
-
-    return calculate_contour_metrics(contours);
-}
+using droplet::ContourMetrics;
 
 int main() {
     cv::utils::logging::setLogLevel(cv::utils::logging::LOG_LEVEL_ERROR);
     cout << "OpenCV version: " << CV_VERSION << endl;
+    // OpenCV 的 parallel_for_ 交給共用的 pool；跨影像平行時影像內部依序執行，不會巢狀開執行緒
+    droplet::install_opencv_backend();
 
     string img_folder = "Test_images\\Slight under focus\\";
     string background_path = img_folder + "background.tiff";
@@ -99,6 +36,9 @@ int main() {
         return -1;
     }
 
+    droplet::DropletPipeline pipeline(droplet::PipelineConfig::open_close_flow());
+    pipeline.set_background(background);
+
     vector<fs::path> image_paths;
     for (const auto & entry : fs::directory_iterator(img_folder)) {
         if (entry.path().extension() == ".tiff" && entry.path().filename() != "background.tiff") {
@@ -111,13 +51,16 @@ int main() {
         return a.filename() < b.filename();
     });
 
-    tbb::concurrent_vector<long long> processing_times;
-    tbb::concurrent_vector<ContourMetrics> results;
+    // 結果與時間依影像索引寫入預先配置的格子：完成順序不影響對應關係，也不需要並行容器
+    droplet::ResultTable<ContourMetrics> results(image_paths.size());
 
     auto start_time = high_resolution_clock::now();
 
-    tbb::parallel_for(tbb::blocked_range<size_t>(0, image_paths.size()),
+    // TBB 本身是 work-stealing；grain 1 讓慢的影像可以被單獨偷走，auto_partitioner 依負載再細分
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, image_paths.size(), 1),
         [&](const tbb::blocked_range<size_t>& r) {
+            // TBB 的 worker 不是 pool 的執行緒，需要自行標記為跨影像平行
+            droplet::FrameParallelScope scope;
             for (size_t i = r.begin(); i != r.end(); ++i) {
                 Mat img = imread(image_paths[i].string(), IMREAD_GRAYSCALE);
                 if (img.empty()) {
@@ -126,12 +69,10 @@ int main() {
                 }
 
                 auto img_start_time = high_resolution_clock::now();
-                ContourMetrics result = process_image(img, background);
+                ContourMetrics result = pipeline.process(img);
                 auto img_end_time = high_resolution_clock::now();
 
-                long long process_time = duration_cast<microseconds>(img_end_time - img_start_time).count();
-                processing_times.push_back(process_time);
-                results.push_back(result);
+                results.set(i, std::move(result), (double)duration_cast<microseconds>(img_end_time - img_start_time).count());
             }
         });
 
@@ -139,20 +80,21 @@ int main() {
     long long total_time = duration_cast<microseconds>(end_time - start_time).count();
 
     cout << "Total processing time: " << total_time << " microseconds" << endl;
-    cout << "Total images processed: " << processing_times.size() << endl;
-    if (!processing_times.empty()) {
-        long long total_processing_time = std::accumulate(processing_times.begin(), processing_times.end(), 0LL);
-        double average_time = static_cast<double>(total_processing_time) / processing_times.size();
-        cout << "Average processing time: " << fixed << setprecision(2) << average_time << " microseconds per image" << endl;
+    cout << "Total images processed: " << results.done_count() << endl;
+    if (results.done_count() > 0) {
+        cout << "Average processing time: " << fixed << setprecision(2) << results.average_time() << " microseconds per image" << endl;
     }
     cout << endl;
 
     for (size_t i = 0; i < image_paths.size(); ++i) {
-        const auto& metrics = results[i];
+        if (!results[i].done) {
+            continue;
+        }
+        const auto& metrics = results[i].value;
 
         cout << "Processing " << image_paths[i].filename() << ":" << endl;
         cout << fixed << setprecision(6);
-        cout << "Processing time: " << processing_times[i] << " microseconds" << endl;
+        cout << "Processing time: " << results[i].time << " microseconds" << endl;
         cout << "Original area: " << metrics.area_original << endl;
         cout << "Convex Hull area: " << metrics.area_hull << endl;
         cout << "Area ratio (hull/original): " << metrics.area_ratio << endl;
@@ -165,8 +107,8 @@ int main() {
         Mat hull_contour_image = Mat::zeros(background.size(), CV_8U);
 
         if (!metrics.contour.empty()) {
-            drawContours(original_contour_image, vector<vector<Point>>{metrics.contour}, -1, Scalar(255), 1);
-            drawContours(hull_contour_image, vector<vector<Point>>{metrics.hull}, -1, Scalar(255), 1);
+            drawContours(original_contour_image, vector<vector<Point>>{metrics.contour.to_vector()}, -1, Scalar(255), 1);
+            drawContours(hull_contour_image, vector<vector<Point>>{metrics.hull.to_vector()}, -1, Scalar(255), 1);
 
             imshow("Original Contour - " + image_paths[i].filename().string(), original_contour_image);
             imshow("Convex Hull - " + image_paths[i].filename().string(), hull_contour_image);
@@ -0,0 +1,129 @@
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "droplet_engine/pipeline.hpp"
+
+using namespace cv;
+using namespace std;
+
+// 攔截全域 operator new（new[] 與 nothrow 版本預設都轉呼叫這一個）。
+// cv::Mat 經由 cv::fastMalloc 配置，另以 PipelineWorkspace::allocations() 檢查
+static atomic<long long> g_allocations{0};
+
+void* operator new(size_t size) {
+    ++g_allocations;
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// 320x240（小於 min_parallel_pixels，影像內部不平行）：漸層背景上一個逐張移動的暗色液滴
+vector<Mat> make_frames(const Mat& background, int count) {
+    vector<Mat> frames;
+    for (int i = 0; i < count; ++i) {
+        Mat frame = background.clone();
+        Point center(80 + 12 * i, 100 + 4 * i);
+        circle(frame, center, 30 + i % 3, Scalar(60), FILLED);
+        frames.push_back(frame);
+    }
+    return frames;
+}
+
+// 處理兩輪同樣的影像：第一輪暖機，第二輪不應配置任何記憶體
+bool check(const string& name, const droplet::PipelineConfig& config, const Mat& background, const vector<Mat>& frames) {
+    droplet::DropletPipeline pipeline(config);
+    pipeline.set_background(background);
+    droplet::PipelineWorkspace workspace;
+    vector<vector<Point>> contours;
+
+    for (const Mat& frame : frames) {
+        pipeline.process(frame, contours, workspace);
+    }
+
+    long long before = g_allocations.load();
+    uint64_t mats_before = workspace.allocations();
+    size_t blocks_before = workspace.points.blocks();
+    int found = 0;
+    for (const Mat& frame : frames) {
+        droplet::ContourMetrics metrics = pipeline.process(frame, contours, workspace);
+        found += metrics.ok() && !metrics.contour.empty() ? 1 : 0;
+    }
+    long long news = g_allocations.load() - before;
+    uint64_t mats = workspace.allocations() - mats_before;
+    size_t blocks = workspace.points.blocks() - blocks_before;
+
+    bool ok = news == 0 && mats == 0 && blocks == 0 && found == (int)frames.size();
+    cout << (ok ? "PASS " : "FAIL ") << name << ": operator new " << news << ", Mat " << mats
+         << ", arena blocks " << blocks << ", droplets " << found << "/" << frames.size() << endl;
+    return ok;
+}
+
+int main() {
+    cv::utils::logging::setLogLevel(cv::utils::logging::LOG_LEVEL_ERROR);
+
+    Mat background(240, 320, CV_8UC1);
+    for (int y = 0; y < background.rows; ++y) {
+        for (int x = 0; x < background.cols; ++x) {
+            background.at<uchar>(y, x) = (uchar)(150 + x / 8 + y / 16);
+        }
+    }
+    vector<Mat> frames = make_frames(background, 8);
+
+    droplet::PipelineConfig traced = droplet::PipelineConfig::open_close_flow();
+    traced.edge = droplet::EdgeMode::None;
+    traced.trace_contours = true;
+
+    droplet::PipelineConfig boundary = traced;
+    boundary.edge = droplet::EdgeMode::Boundary;
+    boundary.morph_backend = droplet::MorphBackend::BitPacked;
+
+    droplet::PipelineConfig components = boundary;
+    components.components_first = true;
+
+    droplet::PipelineConfig cropped = traced;
+    cropped.crop_to_droplet = true;
+    cropped.require_single_complete = true;
+
+    droplet::PipelineConfig parallel = traced;
+    parallel.kernel_shape = MORPH_ELLIPSE;
+    parallel.kernel_size = 5;
+    parallel.morph_backend = droplet::MorphBackend::Parallel;
+
+    droplet::PipelineConfig distance = parallel;
+    distance.morph_backend = droplet::MorphBackend::Distance;
+    distance.blur_difference = true;
+
+    droplet::PipelineConfig runs = droplet::PipelineConfig::open_close_flow();
+    runs.morphology = { {droplet::MorphOp::Dilate, 1}, {droplet::MorphOp::Erode, 1} };
+    runs.edge = droplet::EdgeMode::None;
+    runs.measure_runs = true;
+
+    droplet::PipelineConfig fused_runs = runs;
+    fused_runs.morphology.clear();
+
+    bool ok = true;
+    ok &= check("trace_contours", traced, background, frames);
+    ok &= check("BitPacked + Boundary", boundary, background, frames);
+    ok &= check("components_first", components, background, frames);
+    ok &= check("crop_to_droplet", cropped, background, frames);
+    ok &= check("Parallel ellipse", parallel, background, frames);
+    ok &= check("Distance + blur_difference", distance, background, frames);
+    ok &= check("measure_runs", runs, background, frames);
+    ok &= check("measure_runs (fused)", fused_runs, background, frames);
+
+    return ok ? 0 : 1;
+}
@@ -5,160 +5,87 @@
 #include <filesystem>
 #include <fstream>
 #include <cmath>
-#include <tbb/task_arena.h>
-#include <tbb/task_group.h>
-#include <tbb/concurrent_queue.h>
-#include <atomic>
-#include <mutex>
+#include <utility>
 
-#define _USE_MATH_DEFINES
-#include <math.h>
+#include "droplet_engine/pipeline.hpp"
+#include "droplet_engine/worker_pool.hpp"
+#include "droplet_engine/sharded_stats.hpp"
+#include "droplet_engine/threading_policy.hpp"
 
 namespace fs = std::filesystem;
 using namespace cv;
 using namespace std;
+using droplet::ContourMetrics;
 
-struct ContourMetrics {
-    double area_original = 0;
-    double area_hull = 0;
-    double area_ratio = 0;
-    double circularity_original = 0;
-    double circularity_hull = 0;
-    double circularity_ratio = 0;
-};
-
-ContourMetrics calculate_contour_metrics(const vector<vector<Point>>& contours) {
-    if (contours.empty()) {
-        return ContourMetrics();
-    }
-
-    auto cnt = *max_element(contours.begin(), contours.end(),
-                            [](const auto& c1, const auto& c2) { return contourArea(c1) < contourArea(c2); });
-
-    double area_original = contourArea(cnt);
-    double perimeter_original = arcLength(cnt, true);
-
-    if (area_original <= 1e-6 || perimeter_original <= 1e-6) {
-        return ContourMetrics();
-    }
-
-    double circularity_original = 4 * M_PI * area_original / (perimeter_original * perimeter_original);
-
-    vector<Point> hull;
-    convexHull(cnt, hull);
-
-    double area_hull = contourArea(hull);
-    double perimeter_hull = arcLength(hull, true);
-
-    if (area_hull <= 1e-6 || perimeter_hull <= 1e-6) {
-        return ContourMetrics();
-    }
-
-    double circularity_hull = 4 * M_PI * area_hull / (perimeter_hull * perimeter_hull);
-
-    ContourMetrics results;
-    results.area_original = area_original;
-    results.area_hull = area_hull;
-    results.area_ratio = area_hull / area_original;
-    results.circularity_original = circularity_original;
-    results.circularity_hull = circularity_hull;
-    results.circularity_ratio = circularity_hull / circularity_original;
-
-    return results;
-}
-
-void process_single_image(const string& image_path, const Mat& blurred_bg, vector<vector<Point>>& contours, ContourMetrics& metrics, double& duration) {
+double process_single_image(const string& image_path, const droplet::DropletPipeline& pipeline, droplet::PipelineWorkspace& workspace, vector<vector<Point>>& contours, ContourMetrics& metrics) {
     Mat image = imread(image_path, IMREAD_GRAYSCALE);
     auto start_time = chrono::high_resolution_clock::now();
 
-    Mat kernel = getStructuringElement(MORPH_CROSS, Size(3, 3));
-    Mat blurred;
-    GaussianBlur(image, blurred, Size(5, 5), 0);
-    Mat bg_sub;
-    subtract(blurred_bg, blurred, bg_sub);
-    Mat binary;
-    threshold(bg_sub, binary, 10, 255, THRESH_BINARY);
+    metrics = pipeline.process(image, contours, workspace);
 
-    Mat dilate1, erode1, dilate2;
-    dilate(binary, dilate1, kernel, Point(-1, -1), 2);
-    erode(dilate1, erode1, kernel, Point(-1, -1), 3);
-    dilate(erode1, dilate2, kernel, Point(-1, -1), 1);
-
-    Mat edges;
-    Canny(dilate2, edges, 50, 150);
+    auto end_time = chrono::high_resolution_clock::now();
+    return chrono::duration<double, micro>(end_time - start_time).count();
+}
 
-    vector<Vec4i> hierarchy;
-    findContours(edges, contours, hierarchy, RETR_LIST, CHAIN_APPROX_NONE);
+// 每個 worker 跨實驗重複使用的暫存
+struct WorkerScratch {
+    droplet::PipelineWorkspace workspace;
+    vector<vector<Point>> contours;
+};
 
-    if (contours.empty()) {
-        return;
-    }
+void run_experiment(const vector<fs::path>& image_paths, const droplet::DropletPipeline& pipeline, droplet::WorkerPool& pool, droplet::WorkerLocal<WorkerScratch>& scratch, droplet::ShardedStats& stats, vector<pair<double, double>>& results) {
+    stats.reset();
 
-    auto end_time = chrono::high_resolution_clock::now();
-    duration = chrono::duration<double, micro>(end_time - start_time).count();
+    // 執行緒池與背景在實驗之間保留，每次只量處理本身
+    pool.run(image_paths.size(), [&](size_t i, int worker) {
+        WorkerScratch& s = scratch[worker];
+        ContourMetrics metrics;
+        double process_time = process_single_image(image_paths[i].string(), pipeline, s.workspace, s.contours, metrics);
+        stats.add(worker, process_time, (int64_t)i);
+    });
 
-    metrics = calculate_contour_metrics(contours);
+    droplet::TimeStats total = stats.snapshot();
+    results.push_back({ total.max, total.average() });
 }
 
-void run_experiment(string directory, vector<pair<double, double>>& results) {
+int main() {
+    // OpenCV 的 parallel_for_ 交給共用的 pool；跨影像平行時影像內部依序執行，不會巢狀開執行緒
+    droplet::install_opencv_backend();
+
+    string directory = "Test_images/Slight under focus";
+    vector<pair<double, double>> results;
+
+    // 背景只讀取、模糊一次
     string background_path = directory + "/background.tiff";
     Mat background = imread(background_path, IMREAD_GRAYSCALE);
-    Mat blurred_bg;
-    GaussianBlur(background, blurred_bg, Size(5, 5), 0);
-
-    atomic<double> average_time(0);
-    atomic<int> number(0);
-    atomic<double> max_process_time(0);
-    mutex mtx;
-
-    tbb::task_arena arena(thread::hardware_concurrency());
-    tbb::task_group group;
-    tbb::concurrent_queue<fs::path> image_queue;
-
-    atomic<bool> processing_complete(false);
-
-    arena.execute([&]() {
-        group.run([&]() {
-            while (!processing_complete || !image_queue.empty()) {
-                fs::path path;
-                if (image_queue.try_pop(path)) {
-                    vector<vector<Point>> contours;
-                    ContourMetrics metrics;
-                    double process_time;
-                    process_single_image(path.string(), blurred_bg, contours, metrics, process_time);
-
-                    lock_guard<mutex> lock(mtx);
-                    average_time = average_time + process_time;
-                    if (process_time > max_process_time) {
-                        max_process_time = process_time;
-                    }
-                    number++;
-                } else {
-                    this_thread::yield();
-                }
-            }
-        });
-    });
+    droplet::DropletPipeline pipeline(droplet::PipelineConfig::linear_flow());
+    pipeline.set_background(background);
 
+    vector<fs::path> image_paths;
     for (const auto& entry : fs::directory_iterator(directory)) {
         if (entry.path().extension() == ".tiff" && entry.path().filename() != "background.tiff") {
-            image_queue.push(entry.path());
+            image_paths.push_back(entry.path());
         }
     }
 
-    processing_complete = true;
-    group.wait();
-
-    results.push_back({ max_process_time.load(), average_time.load() / number.load() });
-}
-
-int main() {
-    string directory = "Test_images/Slight under focus";
-    vector<pair<double, double>> results;
+    droplet::WorkerPool& pool = droplet::WorkerPool::shared();
+    droplet::WorkerLocal<WorkerScratch> scratch(pool);
+    // 每個 worker 一個 shard，實驗之間清空重用
+    droplet::ShardedStats stats(pool.size());
+    // 在各自的執行緒上先配置暫存，第一次實驗不包含暖機
+    pool.run_on_each([&scratch](int worker) { scratch[worker].contours.reserve(16); });
 
+    // 第一次實驗配置各 worker 的 workspace，之後影像大小不變時應不再配置
+    uint64_t warm_allocations = 0;
     for (int i = 0; i < 100; ++i) {
-        run_experiment(directory, results);
+        run_experiment(image_paths, pipeline, pool, scratch, stats, results);
+        if (i == 0) {
+            scratch.for_each([&warm_allocations](WorkerScratch& s) { warm_allocations += s.workspace.allocations(); });
+        }
     }
+    uint64_t allocations = 0;
+    scratch.for_each([&allocations](WorkerScratch& s) { allocations += s.workspace.allocations(); });
+    cout << "Workspace allocations after warm-up: " << allocations - warm_allocations << endl;
 
     ofstream file("image_processing_results.csv");
     file << "Max time (C++),Avg time (C++)\n";
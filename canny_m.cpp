@@ -7,87 +7,22 @@
 #include <iomanip>
 #include <filesystem>
 
-#define _USE_MATH_DEFINES
-#include <math.h>
+#include "droplet_engine/pipeline.hpp"
 
 using namespace cv;
 using namespace std;
 using namespace std::chrono;
 namespace fs = std::filesystem;
+using droplet::ContourMetrics;
 
-struct ContourMetrics {
-    double area_original;
-    double area_hull;
-    double area_ratio;
-    double circularity_original;
-    double circularity_hull;
-    double circularity_ratio;
-    vector<Point> contour;
-    vector<Point> hull;
-};
-
-ContourMetrics calculate_contour_metrics(const vector<vector<Point>>& contours) {
-    ContourMetrics results;
-    if (contours.empty()) {
-        return results;
-    }
-
-    auto cnt = *max_element(contours.begin(), contours.end(),
-        [](const vector<Point>& c1, const vector<Point>& c2) {
-            return contourArea(c1) < contourArea(c2);
-        });
-
-    results.area_original = contourArea(cnt);
-    double perimeter_original = arcLength(cnt, true);
-    results.circularity_original = (2 * sqrt(M_PI * results.area_original)) / perimeter_original;
-
-    convexHull(cnt, results.hull);
-
-    results.area_hull = contourArea(results.hull);
-    double perimeter_hull = arcLength(results.hull, true);
-    results.circularity_hull = (2 * sqrt(M_PI * results.area_hull)) / perimeter_hull;
-
-    results.area_ratio = results.area_hull / results.area_original;
-    results.circularity_ratio = results.circularity_hull / results.circularity_original;
-
-    results.contour = cnt;
-
-    return results;
-}
-
-ContourMetrics process_image(const string& img_path, const Mat& background) {
+ContourMetrics process_image(const string& img_path, const droplet::DropletPipeline& pipeline) {
     Mat img = imread(img_path, IMREAD_GRAYSCALE);
     if (img.empty()) {
         cout << "Error: Unable to read image: " << img_path << endl;
         return ContourMetrics();
     }
 
-    Mat blur_img, blur_background;
-    GaussianBlur(img, blur_img, Size(3, 3), 0);
-    GaussianBlur(background, blur_background, Size(3, 3), 0);
-
-    Mat substract;
-    subtract(blur_background, blur_img, substract);
-
-    Mat binary;
-    threshold(substract, binary, 10, 255, THRESH_BINARY);
-
-    Mat kernel = getStructuringElement(MORPH_CROSS, Size(3, 3));
-
-    Mat erode1, dilate1, dilate2, erode2;
-    erode(binary, erode1, kernel);
-    dilate(erode1, dilate1, kernel);
-    dilate(dilate1, dilate2, kernel);
-    erode(dilate2, erode2, kernel);
-
-    Mat edge;
-    Canny(erode2, edge, 50, 150);
-
-    vector<vector<Point>> contours;
-    vector<Vec4i> hierarchy;
-    findContours(edge, contours, hierarchy, RETR_EXTERNAL, CHAIN_APPROX_NONE);
-
-    return calculate_contour_metrics(contours);
+    return pipeline.process(img);
 }
 
 int main() {
@@ -103,6 +38,9 @@ int main() {
         return -1;
     }
 
+    droplet::DropletPipeline pipeline(droplet::PipelineConfig::open_close_flow());
+    pipeline.set_background(background);
+
     vector<fs::path> image_paths;
     for (const auto& entry : fs::directory_iterator(img_folder)) {
         if (entry.path().extension() == ".tiff" && entry.path().filename() != "background.tiff") {
@@ -115,7 +53,7 @@ int main() {
 
     for (const auto& img_path : image_paths) {
         auto start_time = high_resolution_clock::now();
-        ContourMetrics results = process_image(img_path.string(), background);
+        ContourMetrics results = process_image(img_path.string(), pipeline);
         auto end_time = high_resolution_clock::now();
 
         auto process_time = duration_cast<microseconds>(end_time - start_time).count() / 1e6;
@@ -137,8 +75,8 @@ int main() {
         Mat hull_contour_image = Mat::zeros(background.size(), CV_8U);
 
         if (!results.contour.empty()) {
-            drawContours(original_contour_image, vector<vector<Point>>{results.contour}, -1, Scalar(255), 1);
-            drawContours(hull_contour_image, vector<vector<Point>>{results.hull}, -1, Scalar(255), 1);
+            drawContours(original_contour_image, vector<vector<Point>>{results.contour.to_vector()}, -1, Scalar(255), 1);
+            drawContours(hull_contour_image, vector<vector<Point>>{results.hull.to_vector()}, -1, Scalar(255), 1);
 
             imshow("Original Contour - " + img_path.filename().string(), original_contour_image);
             imshow("Convex Hull - " + img_path.filename().string(), hull_contour_image);
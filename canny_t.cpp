@@ -5,11 +5,11 @@
 #include <filesystem>
 #include <chrono>
 #include <thread>
-#include <queue>
-#include <mutex>
-#include <condition_variable>
 #include <numeric>
 
+#include "droplet_engine/channel.hpp"
+#include "droplet_engine/pipeline.hpp"
+
 namespace fs = std::filesystem;
 
 struct ImageData {
@@ -17,83 +17,68 @@ struct ImageData {
     std::string name;
 };
 
-struct ThreadSafeQueue {
-    std::queue<ImageData> queue;
-    std::mutex mutex;
-    std::condition_variable cond;
-
-    void push(ImageData&& data) {
-        std::lock_guard<std::mutex> lock(mutex);
-        queue.push(std::move(data));
-        cond.notify_one();
-    }
+using ImageChannel = droplet::SpscChannel<ImageData>;
 
-    bool pop(ImageData& data) {
-        std::unique_lock<std::mutex> lock(mutex);
-        cond.wait(lock, [this] { return !queue.empty(); });
-        if (queue.empty()) return false;
-        data = std::move(queue.front());
-        queue.pop();
-        return true;
-    }
+// 每張影像只保留指標，不保留影像；記憶體不隨影像數成長
+struct ImageResult {
+    std::string name;
+    double circularity;
+    double hull_circularity;
+    double processing_time;
 };
 
+// 每段之間最多暫存的影像數；解碼比處理快時讀檔端會等待，記憶體不隨影像數成長
+const size_t kChannelCapacity = 8;
+
 cv::Mat load_image(const std::string& image_path) {
     return cv::imread(image_path, cv::IMREAD_GRAYSCALE);
 }
 
-cv::Mat process_image(const cv::Mat& image, const cv::Mat& blurred_bg) {
-    cv::Mat blurred, bg_sub, binary, dilate1, erode1, erode2, dilate2;
-    cv::GaussianBlur(image, blurred, cv::Size(5, 5), 0);
-    cv::subtract(blurred_bg, blurred, bg_sub);
-    cv::threshold(bg_sub, binary, 10, 255, cv::THRESH_BINARY);
-    cv::Mat kernel = cv::getStructuringElement(cv::MORPH_CROSS, cv::Size(3, 3));
-    cv::dilate(binary, dilate1, kernel, cv::Point(-1, -1), 2);
-    cv::erode(dilate1, erode1, kernel, cv::Point(-1, -1), 2);
-    cv::erode(erode1, erode2, kernel, cv::Point(-1, -1), 1);
-    cv::dilate(erode2, dilate2, kernel, cv::Point(-1, -1), 1);
-    return dilate2;
+cv::Mat process_image(const cv::Mat& image, const droplet::DropletPipeline& pipeline) {
+    cv::Mat binary, cleaned;
+    pipeline.segment(image, binary);
+    pipeline.clean(binary, cleaned);
+    return cleaned;
 }
 
-cv::Mat find_contours(const cv::Mat& processed_image) {
+cv::Mat find_contours(const cv::Mat& processed_image, const droplet::DropletPipeline& pipeline) {
     cv::Mat edges, contour_image = cv::Mat::zeros(processed_image.size(), CV_8UC1);
     std::vector<std::vector<cv::Point>> contours;
-    cv::Canny(processed_image, edges, 50, 150);
-    cv::findContours(edges, contours, cv::RETR_LIST, cv::CHAIN_APPROX_SIMPLE);
+    pipeline.extract_edges(processed_image, edges);
+    pipeline.find_contours(edges, contours);
     cv::drawContours(contour_image, contours, -1, cv::Scalar(255), 1);
     return contour_image;
 }
 
-void worker_load(const std::vector<std::string>& image_paths, ThreadSafeQueue& output_queue) {
+void worker_load(const std::vector<std::string>& image_paths, ImageChannel& output_channel) {
     for (const auto& path : image_paths) {
         cv::Mat image = load_image(path);
-        output_queue.push({image, fs::path(path).filename().string()});
+        if (image.empty()) {
+            continue;
+        }
+        if (!output_channel.push({image, fs::path(path).filename().string()})) {
+            break;
+        }
     }
-    output_queue.push({cv::Mat(), ""});  // Sentinel
+    output_channel.close();
 }
 
-void worker_process(ThreadSafeQueue& input_queue, ThreadSafeQueue& output_queue, const cv::Mat& blurred_bg) {
+void worker_process(ImageChannel& input_channel, ImageChannel& output_channel, const droplet::DropletPipeline& pipeline) {
     ImageData data;
-    while (input_queue.pop(data) && !data.image.empty()) {
-        cv::Mat processed = process_image(data.image, blurred_bg);
-        output_queue.push({processed, data.name});
+    while (input_channel.pop(data)) {
+        cv::Mat processed = process_image(data.image, pipeline);
+        output_channel.push({processed, data.name});
     }
-    output_queue.push({cv::Mat(), ""});  // Sentinel
+    output_channel.close();
 }
 
-void worker_contour(ThreadSafeQueue& input_queue, ThreadSafeQueue& output_queue) {
+void worker_contour(ImageChannel& input_channel, ImageChannel& output_channel, const droplet::DropletPipeline& pipeline) {
     ImageData data;
-    while (input_queue.pop(data) && !data.image.empty()) {
-        cv::Mat contour_image = find_contours(data.image);
-        output_queue.push({contour_image, data.name});
+    while (input_channel.pop(data)) {
+        cv::Mat contour_image = find_contours(data.image, pipeline);
+        output_channel.push({contour_image, data.name});
     }
-    output_queue.push({cv::Mat(), ""});  // Sentinel
-}
-
-double calculate_circularity(const std::vector<cv::Point>& contour) {
-    double area = cv::contourArea(contour);
-    double perimeter = cv::arcLength(contour, true);
-    return 4 * CV_PI * area / (perimeter * perimeter);
+    output_channel.close();
 }
 
 int main() {
@@ -109,57 +94,49 @@ int main() {
     }
 
     cv::Mat background = load_image(background_path);
-    cv::Mat blurred_bg;
-    cv::GaussianBlur(background, blurred_bg, cv::Size(5, 5), 0);
-
-    std::vector<ThreadSafeQueue> queues(4);
+    droplet::PipelineConfig config = droplet::PipelineConfig::linear_flow();
+    config.chain_approx = cv::CHAIN_APPROX_SIMPLE;
+    config.metrics.reject_degenerate = false;
+    droplet::DropletPipeline pipeline(config);
+    pipeline.set_background(background);
 
-    std::thread t1(worker_load, std::ref(image_paths), std::ref(queues[1]));
-    std::thread t2(worker_process, std::ref(queues[1]), std::ref(queues[2]), std::ref(blurred_bg));
-    std::thread t3(worker_contour, std::ref(queues[2]), std::ref(queues[3]));
+    // 讀檔 -> 形態學 -> 輪廓 -> 指標，每段一個執行緒，以固定容量的 SPSC 環形通道相接
+    ImageChannel image_channel(kChannelCapacity);
+    ImageChannel processed_channel(kChannelCapacity);
+    ImageChannel contour_channel(kChannelCapacity);
 
     auto start_time = std::chrono::high_resolution_clock::now();
 
-    t1.join();
-    t2.join();
-    t3.join();
+    std::thread t1(worker_load, std::cref(image_paths), std::ref(image_channel));
+    std::thread t2(worker_process, std::ref(image_channel), std::ref(processed_channel), std::cref(pipeline));
+    std::thread t3(worker_contour, std::ref(processed_channel), std::ref(contour_channel), std::cref(pipeline));
 
-    std::vector<std::tuple<std::string, cv::Mat, cv::Mat, cv::Mat, double, double, double>> results;
+    std::vector<ImageResult> results;
     std::vector<double> processing_times;
     ImageData data;
-    while (queues[3].pop(data) && !data.image.empty()) {
+    // 通道有容量上限，必須邊跑邊取，不能等所有執行緒結束後才取
+    while (contour_channel.pop(data)) {
         auto start_time = std::chrono::high_resolution_clock::now();
 
-        cv::Mat original_contour = cv::Mat::zeros(data.image.size(), CV_8UC1);
-        cv::Mat hull_contour = cv::Mat::zeros(data.image.size(), CV_8UC1);
-
         std::vector<std::vector<cv::Point>> contours;
         cv::findContours(data.image, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
 
         if (!contours.empty()) {
-            auto largest_contour = *std::max_element(contours.begin(), contours.end(),
-                [](const std::vector<cv::Point>& c1, const std::vector<cv::Point>& c2) {
-                    return cv::contourArea(c1) < cv::contourArea(c2);
-                });
-
-            std::vector<cv::Point> hull;
-            cv::convexHull(largest_contour, hull);
-
-            double circularity = calculate_circularity(largest_contour);
-            double hull_circularity = calculate_circularity(hull);
-
-            cv::drawContours(original_contour, std::vector<std::vector<cv::Point>>{largest_contour}, -1, cv::Scalar(255), 1);
-            cv::drawContours(hull_contour, std::vector<std::vector<cv::Point>>{hull}, -1, cv::Scalar(255), 1);
+            droplet::ContourMetrics metrics = droplet::calculate_contour_metrics(contours, config.metrics);
 
             auto end_time = std::chrono::high_resolution_clock::now();
             auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
             double processing_time = duration.count() / 1e6;
             processing_times.push_back(processing_time);
 
-            results.push_back(std::make_tuple(data.name, data.image, original_contour, hull_contour, circularity, hull_circularity, processing_time));
+            results.push_back({data.name, metrics.circularity_original, metrics.circularity_hull, processing_time});
         }
     }
 
+    t1.join();
+    t2.join();
+    t3.join();
+
     auto end_time = std::chrono::high_resolution_clock::now();
     auto total_duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
 
@@ -168,19 +145,13 @@ int main() {
     double avg_processing_time = std::accumulate(processing_times.begin(), processing_times.end(), 0.0) / processing_times.size();
     std::cout << "Average processing time per image: " << avg_processing_time << " seconds" << std::endl;
 
-    for (const auto& [name, contour_image, original_contour, hull_contour, circularity, hull_circularity, processing_time] : results) {
-        std::cout << "Image: " << name << std::endl;
-        std::cout << "Processing time: " << processing_time << " seconds" << std::endl;
-        std::cout << "Circularity: " << circularity << std::endl;
-        std::cout << "Hull Circularity: " << hull_circularity << std::endl;
-        std::cout << "Circularity Ratio: " << hull_circularity / circularity << std::endl;
+    for (const ImageResult& result : results) {
+        std::cout << "Image: " << result.name << std::endl;
+        std::cout << "Processing time: " << result.processing_time << " seconds" << std::endl;
+        std::cout << "Circularity: " << result.circularity << std::endl;
+        std::cout << "Hull Circularity: " << result.hull_circularity << std::endl;
+        std::cout << "Circularity Ratio: " << result.hull_circularity / result.circularity << std::endl;
         std::cout << std::endl;
-
-        cv::imshow("Original Contour: " + name, original_contour);
-        cv::imshow("Convex Hull: " + name, hull_contour);
-        std::cout << "Showing contours for image: " << name << ". Press any key to continue..." << std::endl;
-        cv::waitKey(0);
-        cv::destroyAllWindows();
     }
 
     return 0;
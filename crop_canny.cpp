@@ -8,101 +8,15 @@
 #include <filesystem>
 #include <numeric>
 
-#define _USE_MATH_DEFINES
-#include <math.h>
+#include "droplet_engine/pipeline.hpp"
 
 using namespace cv;
 using namespace std;
 using namespace std::chrono;
 namespace fs = std::filesystem;
+using droplet::ContourMetrics;
 
-struct ContourMetrics {
-    double area_original;
-    double area_hull;
-    double area_ratio;
-    double circularity_original;
-    double circularity_hull;
-    double circularity_ratio;
-    vector<Point> contour;
-    vector<Point> hull;
-};
-
-ContourMetrics calculate_contour_metrics(const vector<vector<Point>>& contours) {
-    ContourMetrics results;
-    if (contours.empty()) {
-        return results;
-    }
-
-    auto cnt = *max_element(contours.begin(), contours.end(),
-        [](const vector<Point>& c1, const vector<Point>& c2) {
-            return contourArea(c1) < contourArea(c2);
-        });
-
-    results.area_original = contourArea(cnt);
-    double perimeter_original = arcLength(cnt, true);
-    results.circularity_original = (2 * sqrt(M_PI * results.area_original)) / perimeter_original;
-
-    convexHull(cnt, results.hull);
-
-    results.area_hull = contourArea(results.hull);
-    double perimeter_hull = arcLength(results.hull, true);
-    results.circularity_hull = (2 * sqrt(M_PI * results.area_hull)) / perimeter_hull;
-
-    results.area_ratio = results.area_hull / results.area_original;
-    results.circularity_ratio = results.circularity_hull / results.circularity_original;
-
-    results.contour = cnt;
-
-    return results;
-}
-
-bool is_contour_complete(const vector<Point>& contour, const Size& image_size) {
-    for (const Point& point : contour) {
-        if (point.x <= 0 || point.y <= 0 || point.x >= image_size.width - 1 || point.y >= image_size.height - 1) {
-            return false;
-        }
-    }
-    return true;
-}
-
-ContourMetrics process_image(const Mat& img, const Mat& background, bool use_canny) {
-    Mat blur_img, blur_background;
-    GaussianBlur(img, blur_img, Size(3, 3), 0);
-    GaussianBlur(background, blur_background, Size(3, 3), 0);
-
-    Mat substract;
-    subtract(blur_background, blur_img, substract);
-
-    Mat binary;
-    threshold(substract, binary, 10, 255, THRESH_BINARY);
-
-    Mat kernel = getStructuringElement(MORPH_CROSS, Size(3, 3));
-
-    Mat erode1, dilate1, dilate2, erode2;
-    erode(binary, erode1, kernel);
-    dilate(erode1, dilate1, kernel);
-    dilate(dilate1, dilate2, kernel);
-    erode(dilate2, erode2, kernel);
-
-    Mat edge;
-    if (use_canny) {
-        Canny(erode2, edge, 50, 150);
-    } else {
-        edge = erode2;
-    }
-
-    vector<vector<Point>> contours;
-    vector<Vec4i> hierarchy;
-    findContours(edge, contours, hierarchy, RETR_EXTERNAL, CHAIN_APPROX_NONE);
-
-    if (contours.empty() || contours.size() > 1 || !is_contour_complete(contours[0], img.size())) {
-        return ContourMetrics();
-    }
-
-    return calculate_contour_metrics(contours);
-}
-
-void process_and_compare(const string& img_path, const Mat& background) {
+void process_and_compare(const string& img_path, const droplet::DropletPipeline& canny_pipeline, const droplet::DropletPipeline& plain_pipeline) {
     Mat img = imread(img_path, IMREAD_GRAYSCALE);
     if (img.empty()) {
         cout << "Error: Unable to read image: " << img_path << endl;
@@ -110,7 +24,7 @@ void process_and_compare(const string& img_path, const Mat& background) {
     }
 
     auto start_time_with_canny = high_resolution_clock::now();
-    ContourMetrics results_with_canny = process_image(img, background, true);
+    ContourMetrics results_with_canny = canny_pipeline.process(img);
     auto end_time_with_canny = high_resolution_clock::now();
 
     if (results_with_canny.contour.empty()) {
@@ -119,7 +33,7 @@ void process_and_compare(const string& img_path, const Mat& background) {
     }
 
     auto start_time_without_canny = high_resolution_clock::now();
-    ContourMetrics results_without_canny = process_image(img, background, false);
+    ContourMetrics results_without_canny = plain_pipeline.process(img);
     auto end_time_without_canny = high_resolution_clock::now();
 
     if (results_without_canny.contour.empty()) {
@@ -148,10 +62,10 @@ void process_and_compare(const string& img_path, const Mat& background) {
     Mat contour_image_without_canny = Mat::zeros(img.size(), CV_8U);
     Mat hull_contour_image_without_canny = Mat::zeros(img.size(), CV_8U);
 
-    drawContours(contour_image_with_canny, vector<vector<Point>>{results_with_canny.contour}, -1, Scalar(255), 1);
-    drawContours(hull_contour_image_with_canny, vector<vector<Point>>{results_with_canny.hull}, -1, Scalar(255), 1);
-    drawContours(contour_image_without_canny, vector<vector<Point>>{results_without_canny.contour}, -1, Scalar(255), 1);
-    drawContours(hull_contour_image_without_canny, vector<vector<Point>>{results_without_canny.hull}, -1, Scalar(255), 1);
+    drawContours(contour_image_with_canny, vector<vector<Point>>{results_with_canny.contour.to_vector()}, -1, Scalar(255), 1);
+    drawContours(hull_contour_image_with_canny, vector<vector<Point>>{results_with_canny.hull.to_vector()}, -1, Scalar(255), 1);
+    drawContours(contour_image_without_canny, vector<vector<Point>>{results_without_canny.contour.to_vector()}, -1, Scalar(255), 1);
+    drawContours(hull_contour_image_without_canny, vector<vector<Point>>{results_without_canny.hull.to_vector()}, -1, Scalar(255), 1);
 
     imshow("Contour (With Canny) - " + fs::path(img_path).filename().string(), contour_image_with_canny);
     imshow("Convex Hull (With Canny) - " + fs::path(img_path).filename().string(), hull_contour_image_with_canny);
@@ -174,7 +88,25 @@ int main() {
         return -1;
     }
 
-    vector<double> times_with_canny, times_without_canny;
+    // 只接受單一且完整的輪廓；兩條流程只差在是否做 Canny
+    droplet::PipelineConfig config = droplet::PipelineConfig::open_close_flow();
+    config.require_single_complete = true;
+    config.trace_contours = true;
+    config.components_first = true;
+    droplet::DropletPipeline canny_pipeline(config);
+    canny_pipeline.set_background(background);
+
+    config.edge = droplet::EdgeMode::None;
+    droplet::DropletPipeline plain_pipeline(config);
+    plain_pipeline.set_background(background);
+
+    // 以 mask AND NOT 腐蝕後的 mask 取代 Canny，量測成本與結果差異
+    config.edge = droplet::EdgeMode::Boundary;
+    droplet::DropletPipeline boundary_pipeline(config);
+    boundary_pipeline.set_background(background);
+
+    vector<double> times_with_canny, times_without_canny, times_boundary;
+    double max_boundary_area_diff = 0;
 
     // 第一次遍歷：計算處理時間
     for (const auto& entry : fs::directory_iterator(cropped_folder)) {
@@ -187,18 +119,26 @@ int main() {
             }
 
             auto start_time_with_canny = high_resolution_clock::now();
-            ContourMetrics results_with_canny = process_image(img, background, true);
+            ContourMetrics results_with_canny = canny_pipeline.process(img);
             auto end_time_with_canny = high_resolution_clock::now();
 
             if (!results_with_canny.contour.empty()) {
                 auto start_time_without_canny = high_resolution_clock::now();
-                ContourMetrics results_without_canny = process_image(img, background, false);
+                ContourMetrics results_without_canny = plain_pipeline.process(img);
                 auto end_time_without_canny = high_resolution_clock::now();
 
                 if (!results_without_canny.contour.empty()) {
                     times_with_canny.push_back(duration_cast<microseconds>(end_time_with_canny - start_time_with_canny).count() / 1e6);
                     times_without_canny.push_back(duration_cast<microseconds>(end_time_without_canny - start_time_without_canny).count() / 1e6);
                 }
+
+                auto start_time_boundary = high_resolution_clock::now();
+                ContourMetrics results_boundary = boundary_pipeline.process(img);
+                auto end_time_boundary = high_resolution_clock::now();
+                if (!results_boundary.contour.empty()) {
+                    times_boundary.push_back(duration_cast<microseconds>(end_time_boundary - start_time_boundary).count() / 1e6);
+                    max_boundary_area_diff = max(max_boundary_area_diff, abs(results_boundary.area_original - results_with_canny.area_original));
+                }
             }
         }
     }
@@ -211,6 +151,11 @@ int main() {
         cout << fixed << setprecision(6);
         cout << "Average processing time with Canny: " << avg_with_canny << " seconds" << endl;
         cout << "Average processing time without Canny: " << avg_without_canny << " seconds" << endl;
+        if (!times_boundary.empty()) {
+            double avg_boundary = accumulate(times_boundary.begin(), times_boundary.end(), 0.0) / times_boundary.size();
+            cout << "Average processing time with binary boundary: " << avg_boundary << " seconds" << endl;
+            cout << "Max area difference (boundary vs Canny): " << max_boundary_area_diff << endl;
+        }
         cout << endl;
     } else {
         cout << "No valid images processed." << endl;
@@ -220,7 +165,7 @@ int main() {
     for (const auto& entry : fs::directory_iterator(cropped_folder)) {
         if (entry.path().extension() == ".tiff" && entry.path().filename() != "background.tiff") {
             string img_path = entry.path().string();
-            process_and_compare(img_path, background);
+            process_and_compare(img_path, canny_pipeline, plain_pipeline);
         }
     }
 
@@ -7,115 +7,32 @@
 #include <iomanip>
 #include <filesystem>
 
-#define _USE_MATH_DEFINES
-#include <math.h>
+#include "droplet_engine/pipeline.hpp"
 
 using namespace cv;
 using namespace std;
 using namespace std::chrono;
 namespace fs = std::filesystem;
+using droplet::ContourMetrics;
 
-struct ContourMetrics {
-    double area_original;
-    double area_hull;
-    double area_ratio;
-    double circularity_original;
-    double circularity_hull;
-    double circularity_ratio;
-    vector<Point> contour;
-    vector<Point> hull;
-};
-
-ContourMetrics calculate_contour_metrics(const vector<vector<Point>>& contours) {
-    ContourMetrics results;
-    if (contours.empty()) {
-        return results;
-    }
-
-    auto cnt = *max_element(contours.begin(), contours.end(),
-        [](const vector<Point>& c1, const vector<Point>& c2) {
-            return contourArea(c1) < contourArea(c2);
-        });
-
-    results.area_original = contourArea(cnt);
-    double perimeter_original = arcLength(cnt, true);
-    results.circularity_original = (2 * sqrt(M_PI * results.area_original)) / perimeter_original;
-
-    convexHull(cnt, results.hull);
-
-    results.area_hull = contourArea(results.hull);
-    double perimeter_hull = arcLength(results.hull, true);
-    results.circularity_hull = (2 * sqrt(M_PI * results.area_hull)) / perimeter_hull;
-
-    results.area_ratio = results.area_hull / results.area_original;
-    results.circularity_ratio = results.circularity_hull / results.circularity_original;
-
-    results.contour = cnt;
-
-    return results;
-}
-
-bool is_contour_complete(const vector<Point>& contour, const Size& image_size) {
-    for (const Point& point : contour) {
-        if (point.x <= 0 || point.y <= 0 || point.x >= image_size.width - 1 || point.y >= image_size.height - 1) {
-            return false;
-        }
-    }
-    return true;
-}
-
-ContourMetrics process_image(const string& img_path, const Mat& background) {
+ContourMetrics process_image(const string& img_path, const droplet::DropletPipeline& pipeline) {
     Mat img = imread(img_path, IMREAD_GRAYSCALE);
     if (img.empty()) {
         cout << "Error: Unable to read image: " << img_path << endl;
         return ContourMetrics();
     }
 
-    Mat blur_img, blur_background;
-    GaussianBlur(img, blur_img, Size(3, 3), 0);
-    GaussianBlur(background, blur_background, Size(3, 3), 0);
-
-    Mat substract;
-    subtract(blur_background, blur_img, substract);
-
-    Mat binary;
-    threshold(substract, binary, 10, 255, THRESH_BINARY);
-
-    Mat kernel = getStructuringElement(MORPH_CROSS, Size(3, 3));
-
-    Mat erode1, dilate1, dilate2, erode2;
-    erode(binary, erode1, kernel);
-    dilate(erode1, dilate1, kernel);
-    dilate(dilate1, dilate2, kernel);
-    erode(dilate2, erode2, kernel);
-
-    Mat edge;
-    Canny(erode2, edge, 50, 150);
-
-    vector<vector<Point>> contours;
-    vector<Vec4i> hierarchy;
-    findContours(edge, contours, hierarchy, RETR_EXTERNAL, CHAIN_APPROX_NONE);
-
-    // 如果沒有找到輪廓或找到的輪廓數量超過一個，返回空結果
-    if (contours.empty() || contours.size() > 1) {
-        return ContourMetrics();
-    }
-
-    // 檢查輪廓是否完整
-    if (!is_contour_complete(contours[0], img.size())) {
-        return ContourMetrics();
-    }
-
-    return calculate_contour_metrics(contours);
+    // 沒有輪廓、多於一個輪廓或輪廓不完整時回傳空結果
+    return pipeline.process(img);
 }
 
-void process_and_compare(const string& original_path, const string& cropped_path, const Mat& original_background, const Mat& cropped_background) {
+void process_and_compare(const string& original_path, const string& cropped_path, const droplet::DropletPipeline& original_pipeline, const droplet::DropletPipeline& cropped_pipeline) {
     auto start_time_original = high_resolution_clock::now();
-    ContourMetrics original_results = process_image(original_path, original_background);
+    ContourMetrics original_results = process_image(original_path, original_pipeline);
     auto end_time_original = high_resolution_clock::now();
 
     auto start_time_cropped = high_resolution_clock::now();
-    ContourMetrics cropped_results = process_image(cropped_path, cropped_background);
+    ContourMetrics cropped_results = process_image(cropped_path, cropped_pipeline);
     auto end_time_cropped = high_resolution_clock::now();
 
     // 檢查是否找到輪廓
@@ -140,15 +57,15 @@ void process_and_compare(const string& original_path, const string& cropped_path
     cout << endl;
 
     // 繪製輪廓
-    Mat original_contour_image = Mat::zeros(original_background.size(), CV_8U);
-    Mat original_hull_contour_image = Mat::zeros(original_background.size(), CV_8U);
-    Mat cropped_contour_image = Mat::zeros(cropped_background.size(), CV_8U);
-    Mat cropped_hull_contour_image = Mat::zeros(cropped_background.size(), CV_8U);
+    Mat original_contour_image = Mat::zeros(original_pipeline.blurred_background().size(), CV_8U);
+    Mat original_hull_contour_image = Mat::zeros(original_pipeline.blurred_background().size(), CV_8U);
+    Mat cropped_contour_image = Mat::zeros(cropped_pipeline.blurred_background().size(), CV_8U);
+    Mat cropped_hull_contour_image = Mat::zeros(cropped_pipeline.blurred_background().size(), CV_8U);
 
-    drawContours(original_contour_image, vector<vector<Point>>{original_results.contour}, -1, Scalar(255), 1);
-    drawContours(original_hull_contour_image, vector<vector<Point>>{original_results.hull}, -1, Scalar(255), 1);
-    drawContours(cropped_contour_image, vector<vector<Point>>{cropped_results.contour}, -1, Scalar(255), 1);
-    drawContours(cropped_hull_contour_image, vector<vector<Point>>{cropped_results.hull}, -1, Scalar(255), 1);
+    drawContours(original_contour_image, vector<vector<Point>>{original_results.contour.to_vector()}, -1, Scalar(255), 1);
+    drawContours(original_hull_contour_image, vector<vector<Point>>{original_results.hull.to_vector()}, -1, Scalar(255), 1);
+    drawContours(cropped_contour_image, vector<vector<Point>>{cropped_results.contour.to_vector()}, -1, Scalar(255), 1);
+    drawContours(cropped_hull_contour_image, vector<vector<Point>>{cropped_results.hull.to_vector()}, -1, Scalar(255), 1);
 
     imshow("Original Contour - " + fs::path(original_path).filename().string(), original_contour_image);
     imshow("Original Convex Hull - " + fs::path(original_path).filename().string(), original_hull_contour_image);
@@ -179,13 +96,22 @@ int main() {
         return -1;
     }
 
+    droplet::PipelineConfig config = droplet::PipelineConfig::open_close_flow();
+    config.require_single_complete = true;
+    config.trace_contours = true;
+    config.components_first = true;
+    droplet::DropletPipeline original_pipeline(config);
+    original_pipeline.set_background(original_background);
+    droplet::DropletPipeline cropped_pipeline(config);
+    cropped_pipeline.set_background(cropped_background);
+
     for (const auto& entry : fs::directory_iterator(original_folder)) {
         if (entry.path().extension() == ".tiff" && entry.path().filename() != "background.tiff") {
             string original_path = entry.path().string();
             string cropped_path = cropped_folder + entry.path().filename().string();
 
             if (fs::exists(cropped_path)) {
-                process_and_compare(original_path, cropped_path, original_background, cropped_background);
+                process_and_compare(original_path, cropped_path, original_pipeline, cropped_pipeline);
             } else {
                 cout << "Cropped image not found for: " << entry.path().filename() << endl;
             }
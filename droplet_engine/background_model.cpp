@@ -0,0 +1,178 @@
+#include "droplet_engine/background_model.hpp"
+#include "droplet_engine/fixed_gaussian.hpp"
+#include "droplet_engine/threading_policy.hpp"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace droplet {
+
+namespace {
+
+#if CV_SIMD128
+// 16 個 uchar 展開成 4 組 float
+inline void load_expand_f32(const uchar* src, cv::v_float32x4 out[4]) {
+    cv::v_uint16x8 lo, hi;
+    cv::v_expand(cv::v_load(src), lo, hi);
+    cv::v_uint32x4 q0, q1, q2, q3;
+    cv::v_expand(lo, q0, q1);
+    cv::v_expand(hi, q2, q3);
+    out[0] = cv::v_cvt_f32(cv::v_reinterpret_as_s32(q0));
+    out[1] = cv::v_cvt_f32(cv::v_reinterpret_as_s32(q1));
+    out[2] = cv::v_cvt_f32(cv::v_reinterpret_as_s32(q2));
+    out[3] = cv::v_cvt_f32(cv::v_reinterpret_as_s32(q3));
+}
+#endif
+
+void accumulate_row(const uchar* src, float* acc, int width, BackgroundUpdate mode, float alpha) {
+    int x = 0;
+#if CV_SIMD128
+    cv::v_float32x4 v_alpha = cv::v_setall_f32(alpha);
+    for (; x <= width - 16; x += 16) {
+        cv::v_float32x4 f[4];
+        load_expand_f32(src + x, f);
+        for (int i = 0; i < 4; ++i) {
+            cv::v_float32x4 a = cv::v_load(acc + x + 4 * i);
+            if (mode == BackgroundUpdate::RunningAverage) {
+                a = cv::v_fma(f[i] - a, v_alpha, a);
+            } else {
+                a = cv::v_min(a, f[i]);
+            }
+            cv::v_store(acc + x + 4 * i, a);
+        }
+    }
+#endif
+    for (; x < width; ++x) {
+        if (mode == BackgroundUpdate::RunningAverage) {
+            acc[x] += alpha * (src[x] - acc[x]);
+        } else {
+            acc[x] = std::min(acc[x], (float)src[x]);
+        }
+    }
+}
+
+void load_row(const uchar* src, float* acc, int width) {
+    int x = 0;
+#if CV_SIMD128
+    for (; x <= width - 16; x += 16) {
+        cv::v_float32x4 f[4];
+        load_expand_f32(src + x, f);
+        for (int i = 0; i < 4; ++i) {
+            cv::v_store(acc + x + 4 * i, f[i]);
+        }
+    }
+#endif
+    for (; x < width; ++x) {
+        acc[x] = src[x];
+    }
+}
+
+// 四捨五入回 uchar（累加值介於 0 ~ 255，不需飽和以外的處理）
+void store_row(const float* acc, uchar* dst, int width) {
+    int x = 0;
+#if CV_SIMD128
+    for (; x <= width - 16; x += 16) {
+        cv::v_int16x8 lo = cv::v_pack(cv::v_round(cv::v_load(acc + x)), cv::v_round(cv::v_load(acc + x + 4)));
+        cv::v_int16x8 hi = cv::v_pack(cv::v_round(cv::v_load(acc + x + 8)), cv::v_round(cv::v_load(acc + x + 12)));
+        cv::v_store(dst + x, cv::v_pack_u(lo, hi));
+    }
+#endif
+    for (; x < width; ++x) {
+        dst[x] = cv::saturate_cast<uchar>(acc[x]);
+    }
+}
+
+} // namespace
+
+BackgroundModel::BackgroundModel(const cv::Mat& background, std::vector<int> kernel_sizes)
+    : size_(background.size()), kernel_sizes_(std::move(kernel_sizes)), current_(0) {
+    CV_Assert(background.type() == CV_8UC1 && !background.empty());
+    readers_[0].store(0);
+    readers_[1].store(0);
+    accumulator_.create(size_, CV_32FC1);
+    for (int y = 0; y < size_.height; ++y) {
+        load_row(background.ptr<uchar>(y), accumulator_.ptr<float>(y), size_.width);
+    }
+    publish();
+}
+
+bool BackgroundModel::has_kernel(int ksize) const {
+    return std::find(kernel_sizes_.begin(), kernel_sizes_.end(), ksize) != kernel_sizes_.end();
+}
+
+int BackgroundModel::acquire() const {
+    for (;;) {
+        int slot = current_.load();
+        readers_[slot].fetch_add(1);
+        // 登記之後再確認：槽已被換下時寫入端可能正在重填，放開重試
+        if (current_.load() == slot) {
+            return slot;
+        }
+        readers_[slot].fetch_sub(1);
+    }
+}
+
+void BackgroundModel::release(int slot) const {
+    readers_[slot].fetch_sub(1);
+}
+
+cv::Mat BackgroundModel::raw() const {
+    int slot = acquire();
+    cv::Mat raw = slots_[slot].raw;
+    release(slot);
+    return raw;
+}
+
+cv::Mat BackgroundModel::blurred(int ksize) const {
+    size_t i = std::find(kernel_sizes_.begin(), kernel_sizes_.end(), ksize) - kernel_sizes_.begin();
+    CV_Assert(i < kernel_sizes_.size());
+    int slot = acquire();
+    cv::Mat blurred = slots_[slot].blurred[i];
+    release(slot);
+    return blurred;
+}
+
+uint64_t BackgroundModel::version() const {
+    int slot = acquire();
+    uint64_t version = slots_[slot].version;
+    release(slot);
+    return version;
+}
+
+void BackgroundModel::update(const cv::Mat& empty_frame, BackgroundUpdate mode, double alpha) {
+    CV_Assert(empty_frame.type() == CV_8UC1 && empty_frame.size() == size_);
+    CV_Assert(alpha > 0 && alpha <= 1);
+    std::lock_guard<std::mutex> lock(writer_);
+
+    #pragma omp parallel for if(parallel_within_frame(ParallelStage::Background, size_.area()))
+    for (int y = 0; y < size_.height; ++y) {
+        accumulate_row(empty_frame.ptr<uchar>(y), accumulator_.ptr<float>(y), size_.width, mode, (float)alpha);
+    }
+    publish();
+}
+
+void BackgroundModel::publish() {
+    // 只有寫入端會切換 current_；另一個槽上的讀者都還沒通過確認，等它們放開
+    int next = 1 - current_.load();
+    while (readers_[next].load() != 0) {
+        std::this_thread::yield();
+    }
+
+    // 每個版本都是新的 Mat：讀取端拿到的舊版本可能仍在使用，不能就地覆寫
+    Version& slot = slots_[next];
+    slot.version = next_version_++;
+    slot.raw = cv::Mat(size_, CV_8UC1);
+    for (int y = 0; y < size_.height; ++y) {
+        store_row(accumulator_.ptr<float>(y), slot.raw.ptr<uchar>(y), size_.width);
+    }
+    slot.blurred.resize(kernel_sizes_.size());
+    for (size_t i = 0; i < kernel_sizes_.size(); ++i) {
+        slot.blurred[i] = cv::Mat();
+        gaussian_blur(slot.raw, slot.blurred[i], kernel_sizes_[i]);
+    }
+    current_.store(next);
+}
+
+} // namespace droplet
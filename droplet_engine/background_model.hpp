@@ -0,0 +1,62 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace droplet {
+
+enum class BackgroundUpdate {
+    RunningAverage,     // bg += alpha * (frame - bg)
+    RunningMin          // bg = min(bg, frame)：液滴比背景暗，只吸收變暗的漂移
+};
+
+// 背景只在更新時模糊一次（每種 kernel 大小各一份），處理影像時直接取用；
+// kernel_sizes 為空時只保存原始背景（PipelineConfig::blur_difference）。
+// 讀取端不加鎖、不複製影像：版本放在兩個輪流使用的槽中，讀取時先在槽上登記讀者，
+// 確認它仍是目前版本後複製 Mat 標頭（參考計數）就放開。寫入端只重填沒有讀者的另一個槽，
+// 填好後才切換目前版本；舊槽上只可能有剛讀到舊索引、正要確認的讀者，寫入端等它們放開即可。
+// update 只在判定為空白的影像上呼叫，內部以 mutex 保證同時只有一個寫入者（讀取端不受影響）。
+class BackgroundModel {
+public:
+    explicit BackgroundModel(const cv::Mat& background, std::vector<int> kernel_sizes = { 3, 5 });
+
+    bool has_kernel(int ksize) const;
+    // 目前版本的原始 / 模糊背景。回傳的 Mat 與該版本共用資料（含參考計數），之後的更新不會改動它
+    cv::Mat raw() const;
+    cv::Mat blurred(int ksize) const;
+    // 建構時為 0，每次 update 加 1
+    uint64_t version() const;
+
+    // 每像素 O(1) 的 SIMD 更新，之後重新模糊並發布新版本
+    void update(const cv::Mat& empty_frame, BackgroundUpdate mode = BackgroundUpdate::RunningAverage,
+                double alpha = 0.05);
+
+    const cv::Size& size() const { return size_; }
+
+private:
+    // 某一版背景；發布後到下一次重填之前不再修改
+    struct Version {
+        cv::Mat raw;
+        std::vector<cv::Mat> blurred;   // 與 kernel_sizes_ 一一對應
+        uint64_t version = 0;
+    };
+
+    // 登記並回傳目前版本的槽；讀完後呼叫 release
+    int acquire() const;
+    void release(int slot) const;
+    void publish();
+
+    cv::Size size_;
+    std::vector<int> kernel_sizes_;
+    cv::Mat accumulator_;       // CV_32FC1，避免 8 位元累加的捨入漂移
+    Version slots_[2];
+    mutable std::atomic<int> readers_[2];
+    std::atomic<int> current_;
+    uint64_t next_version_ = 0;
+    std::mutex writer_;
+};
+
+} // namespace droplet
@@ -0,0 +1,60 @@
+#include "droplet_engine/binary_boundary.hpp"
+#include "droplet_engine/threading_policy.hpp"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+
+namespace droplet {
+
+namespace {
+
+// 0 / 255 影像上 AND 等於取最小值；影像外視為背景，第一 / 最後一列（up / down 為 nullptr）
+// 與第一 / 最後一欄的前景都是邊界
+void boundary_row(const uchar* up, const uchar* cur, const uchar* down, uchar* dst, int width) {
+    if (!up || !down) {
+        std::copy(cur, cur + width, dst);
+        return;
+    }
+    auto scalar = [&](int x) {
+        uchar eroded = cur[x] & up[x] & down[x];
+        eroded &= x > 0 ? cur[x - 1] : 0;
+        eroded &= x + 1 < width ? cur[x + 1] : 0;
+        dst[x] = cur[x] & (uchar)~eroded;
+    };
+
+    if (width <= 0) {
+        return;
+    }
+    scalar(0);
+    int x = 1;
+#if CV_SIMD128
+    // 讀到 x + 16（右鄰），最後一欄留給純量處理
+    for (; x + 16 < width; x += 16) {
+        cv::v_uint8x16 c = cv::v_load(cur + x);
+        cv::v_uint8x16 eroded = c & cv::v_load(up + x) & cv::v_load(down + x) &
+                                cv::v_load(cur + x - 1) & cv::v_load(cur + x + 1);
+        cv::v_store(dst + x, c & ~eroded);
+    }
+#endif
+    for (; x < width; ++x) {
+        scalar(x);
+    }
+}
+
+} // namespace
+
+void binary_boundary(const cv::Mat& mask, cv::Mat& dst) {
+    CV_Assert(mask.type() == CV_8UC1);
+    CV_Assert(dst.data != mask.data || mask.empty());
+    dst.create(mask.size(), CV_8UC1);
+
+    int rows = mask.rows;
+    #pragma omp parallel for schedule(static) if(parallel_within_frame(ParallelStage::OpenCV, mask.rows * mask.cols))
+    for (int y = 0; y < rows; ++y) {
+        const uchar* up = y > 0 ? mask.ptr<uchar>(y - 1) : nullptr;
+        const uchar* down = y + 1 < rows ? mask.ptr<uchar>(y + 1) : nullptr;
+        boundary_row(up, mask.ptr<uchar>(y), down, dst.ptr<uchar>(y), mask.cols);
+    }
+}
+
+} // namespace droplet
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+namespace droplet {
+
+// 0 / 255 二值影像（CV_8UC1）的內邊界：mask AND NOT erode(mask, 3x3 十字)，
+// 即前景中四鄰域有背景的像素，8 連通、寬 1 像素。影像外視為背景（與 cv::erode 的預設邊界值不同），
+// 貼著影像邊緣的前景也是邊界，因此每個前景區塊（含碰到影像邊緣的）的外輪廓都與直接在 mask 上找的相同。
+// 只做一次逐列 SIMD 掃描，取代在已二值化的影像上做 Canny。以列帶分段平行（依 ParallelStage::OpenCV）。
+// dst 不可與 mask 共用資料；大小、型別相同時直接覆寫
+void binary_boundary(const cv::Mat& mask, cv::Mat& dst);
+
+} // namespace droplet
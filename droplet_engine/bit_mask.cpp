@@ -0,0 +1,285 @@
+#include "droplet_engine/bit_mask.hpp"
+#include "droplet_engine/threading_policy.hpp"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <utility>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace droplet {
+
+namespace {
+
+inline int popcount64(uint64_t v) {
+#if defined(_MSC_VER)
+    return (int)__popcnt64(v);
+#else
+    return __builtin_popcountll(v);
+#endif
+}
+
+// 每個執行緒一份的中間結果；create / 複製時容量足夠就不重新配置
+struct BitScratch {
+    BitMask result, next;       // bit_morph 的迭代
+    BitMask horizontal, spread; // 水平方向的擴張
+    BitMask stages[2];          // run_bit_morphology 各段的輸出
+};
+
+thread_local BitScratch tls_bits;
+
+// 水平半徑 1：pixel x 取 x - 1、x、x + 1 的 AND（腐蝕）或 OR（膨脹）
+// 影像外與補齊位元視為單位元素（腐蝕為 1、膨脹為 0）
+template<bool Erode>
+void horizontal_spread(const BitMask& src, BitMask& dst) {
+    int words = src.words_per_row();
+    uint64_t tail = src.tail_mask();
+    uint64_t fill = Erode ? ~0ULL : 0ULL;
+
+    #pragma omp parallel for if(parallel_within_frame(ParallelStage::Morphology, src.rows() * src.cols()))
+    for (int y = 0; y < src.rows(); ++y) {
+        const uint64_t* s = src.row(y);
+        uint64_t* d = dst.row(y);
+        uint64_t prev = fill;
+        uint64_t cur = s[0] | ((Erode && words == 1) ? ~tail : 0ULL);
+        for (int i = 0; i < words; ++i) {
+            uint64_t next = fill;
+            if (i + 1 < words) {
+                next = s[i + 1] | ((Erode && i + 1 == words - 1) ? ~tail : 0ULL);
+            }
+            uint64_t left = (cur << 1) | (prev >> 63);
+            uint64_t right = (cur >> 1) | (next << 63);
+            d[i] = Erode ? (cur & left & right) : (cur | left | right);
+            prev = cur;
+            cur = next;
+        }
+        d[words - 1] &= tail;
+    }
+}
+
+template<bool Erode>
+inline void combine_words(uint64_t* dst, const uint64_t* src, int words) {
+    for (int i = 0; i < words; ++i) {
+        dst[i] = Erode ? (dst[i] & src[i]) : (dst[i] | src[i]);
+    }
+}
+
+// 3x3 十字一次：水平三格，再與上下兩列結合；影像外的列為單位元素，直接略過
+template<bool Erode>
+void cross_step(const BitMask& src, BitMask& dst, BitMask& horizontal) {
+    horizontal.create(src.rows(), src.cols());
+    horizontal_spread<Erode>(src, horizontal);
+
+    int words = src.words_per_row();
+    dst.create(src.rows(), src.cols());
+
+    #pragma omp parallel for if(parallel_within_frame(ParallelStage::Morphology, src.rows() * src.cols()))
+    for (int y = 0; y < src.rows(); ++y) {
+        uint64_t* d = dst.row(y);
+        std::copy(horizontal.row(y), horizontal.row(y) + words, d);
+        if (y > 0) {
+            combine_words<Erode>(d, src.row(y - 1), words);
+        }
+        if (y + 1 < src.rows()) {
+            combine_words<Erode>(d, src.row(y + 1), words);
+        }
+    }
+}
+
+// 邊長 2 * radius + 1 的正方形：水平與垂直可分離
+template<bool Erode>
+void square_step(const BitMask& src, BitMask& dst, int radius, BitMask& horizontal, BitMask& spread) {
+    horizontal = src;
+    spread.create(src.rows(), src.cols());
+    for (int r = 0; r < radius; ++r) {
+        horizontal_spread<Erode>(horizontal, spread);
+        std::swap(horizontal, spread);
+    }
+
+    int words = src.words_per_row();
+    dst.create(src.rows(), src.cols());
+
+    #pragma omp parallel for if(parallel_within_frame(ParallelStage::Morphology, src.rows() * src.cols()))
+    for (int y = 0; y < src.rows(); ++y) {
+        uint64_t* d = dst.row(y);
+        std::copy(horizontal.row(y), horizontal.row(y) + words, d);
+        int y0 = std::max(0, y - radius);
+        int y1 = std::min(src.rows() - 1, y + radius);
+        for (int sy = y0; sy <= y1; ++sy) {
+            if (sy != y) {
+                combine_words<Erode>(d, horizontal.row(sy), words);
+            }
+        }
+    }
+}
+
+template<bool Erode>
+void bit_morph(const BitMask& src, BitMask& dst, int kernel_shape, int kernel_size, int iterations) {
+    CV_Assert(bit_morph_supported(kernel_shape, kernel_size));
+    int radius = kernel_size / 2;
+    if (src.empty() || iterations <= 0 || radius == 0) {
+        dst = src;
+        return;
+    }
+
+    // 平行區段內只經由參考使用，不會取到其他執行緒的暫存
+    BitScratch& scratch = tls_bits;
+    BitMask& result = scratch.result;
+    BitMask& next = scratch.next;
+    BitMask& horizontal = scratch.horizontal;
+    BitMask& spread = scratch.spread;
+    if (kernel_shape == cv::MORPH_RECT) {
+        // k x k 迭代 n 次 = 邊長 n * (k - 1) + 1 的正方形
+        square_step<Erode>(src, result, iterations * radius, horizontal, spread);
+    } else if (kernel_size == 3) {
+        result = src;
+        for (int i = 0; i < iterations; ++i) {
+            cross_step<Erode>(result, next, horizontal);
+            std::swap(result, next);
+        }
+    } else {
+        // 較大的十字：水平、垂直兩條線段的聯集
+        result = src;
+        for (int i = 0; i < iterations; ++i) {
+            horizontal = result;
+            spread.create(src.rows(), src.cols());
+            for (int r = 0; r < radius; ++r) {
+                horizontal_spread<Erode>(horizontal, spread);
+                std::swap(horizontal, spread);
+            }
+            int words = src.words_per_row();
+            next.create(src.rows(), src.cols());
+
+            #pragma omp parallel for if(parallel_within_frame(ParallelStage::Morphology, src.rows() * src.cols()))
+            for (int y = 0; y < src.rows(); ++y) {
+                uint64_t* d = next.row(y);
+                std::copy(horizontal.row(y), horizontal.row(y) + words, d);
+                int y0 = std::max(0, y - radius);
+                int y1 = std::min(src.rows() - 1, y + radius);
+                for (int sy = y0; sy <= y1; ++sy) {
+                    if (sy != y) {
+                        combine_words<Erode>(d, result.row(sy), words);
+                    }
+                }
+            }
+            std::swap(result, next);
+        }
+    }
+    // 交換後 dst 原本的緩衝留在暫存中，下一次重複使用
+    std::swap(dst, result);
+}
+
+} // namespace
+
+BitMask::BitMask(int rows, int cols) {
+    create(rows, cols);
+}
+
+void BitMask::create(int rows, int cols) {
+    CV_Assert(rows >= 0 && cols >= 0);
+    rows_ = rows;
+    cols_ = cols;
+    words_per_row_ = (cols + 63) / 64;
+    bits_.assign((size_t)rows_ * words_per_row_, 0);
+}
+
+uint64_t BitMask::tail_mask() const {
+    int used = cols_ & 63;
+    return used == 0 ? ~0ULL : ((1ULL << used) - 1);
+}
+
+BitMask BitMask::from_mat(const cv::Mat& binary) {
+    BitMask mask;
+    mask.assign(binary);
+    return mask;
+}
+
+void BitMask::assign(const cv::Mat& binary) {
+    CV_Assert(binary.type() == CV_8UC1);
+    create(binary.rows, binary.cols);
+
+    #pragma omp parallel for if(parallel_within_frame(ParallelStage::Morphology, binary.rows * binary.cols))
+    for (int y = 0; y < binary.rows; ++y) {
+        const uchar* src = binary.ptr<uchar>(y);
+        uint64_t* dst = row(y);
+        int x = 0;
+#if CV_SIMD128
+        cv::v_uint8x16 zero = cv::v_setzero_u8();
+        for (; x <= binary.cols - 64; x += 64) {
+            uint64_t word = 0;
+            for (int k = 0; k < 4; ++k) {
+                cv::v_uint8x16 v = cv::v_load(src + x + 16 * k);
+                word |= (uint64_t)(unsigned)cv::v_signmask(v != zero) << (16 * k);
+            }
+            dst[x >> 6] = word;
+        }
+#endif
+        for (; x < binary.cols; ++x) {
+            if (src[x]) {
+                dst[x >> 6] |= 1ULL << (x & 63);
+            }
+        }
+    }
+}
+
+void BitMask::to_mat(cv::Mat& dst) const {
+    dst.create(rows_, cols_, CV_8UC1);
+
+    #pragma omp parallel for if(parallel_within_frame(ParallelStage::Morphology, rows_ * cols_))
+    for (int y = 0; y < rows_; ++y) {
+        const uint64_t* src = row(y);
+        uchar* out = dst.ptr<uchar>(y);
+        for (int x = 0; x < cols_; ++x) {
+            out[x] = (uchar)(0 - (int)((src[x >> 6] >> (x & 63)) & 1));
+        }
+    }
+}
+
+int64_t BitMask::count() const {
+    int64_t total = 0;
+    for (uint64_t word : bits_) {
+        total += popcount64(word);
+    }
+    return total;
+}
+
+bool bit_morph_supported(int kernel_shape, int kernel_size) {
+    return (kernel_shape == cv::MORPH_RECT || kernel_shape == cv::MORPH_CROSS) && kernel_size > 0 && kernel_size % 2 == 1;
+}
+
+void bit_erode(const BitMask& src, BitMask& dst, int kernel_shape, int kernel_size, int iterations) {
+    bit_morph<true>(src, dst, kernel_shape, kernel_size, iterations);
+}
+
+void bit_dilate(const BitMask& src, BitMask& dst, int kernel_shape, int kernel_size, int iterations) {
+    bit_morph<false>(src, dst, kernel_shape, kernel_size, iterations);
+}
+
+void run_bit_morphology(const std::vector<MorphStep>& steps, int kernel_shape, int kernel_size,
+                        const BitMask& src, BitMask& dst) {
+    BitMask* stages = tls_bits.stages;
+    const BitMask* cur = &src;
+    int next = 0;
+    size_t i = 0;
+    while (i < steps.size()) {
+        MorphOp op = steps[i].op;
+        int iterations = 0;
+        for (; i < steps.size() && steps[i].op == op; ++i) {
+            iterations += std::max(0, steps[i].iterations);
+        }
+        if (op == MorphOp::Erode) {
+            bit_erode(*cur, stages[next], kernel_shape, kernel_size, iterations);
+        } else {
+            bit_dilate(*cur, stages[next], kernel_shape, kernel_size, iterations);
+        }
+        cur = &stages[next];
+        next ^= 1;
+    }
+    if (cur != &dst) {
+        dst = *cur;
+    }
+}
+
+} // namespace droplet
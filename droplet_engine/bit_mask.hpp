@@ -0,0 +1,64 @@
+#pragma once
+
+#include "droplet_engine/morphology.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace droplet {
+
+// 每像素 1 bit 的二值影像；每列補齊到 64 位元 word，
+// 第 x 個像素在 word x / 64 的第 x % 64 位元（最低位元在左）。
+// 每列最後一個 word 超出 cols 的位元恆為 0。
+class BitMask {
+public:
+    BitMask() = default;
+    BitMask(int rows, int cols);
+
+    // 非 0 像素視為 1；只在流程入口（二值化之後）呼叫一次
+    static BitMask from_mat(const cv::Mat& binary);
+    // 同上，寫入既有的 mask；容量足夠時不重新配置（PipelineWorkspace 每個 worker 一份）
+    void assign(const cv::Mat& binary);
+    // 轉回 0 / 255 的 CV_8UC1；只在流程出口（Canny / findContours 之前）呼叫一次
+    void to_mat(cv::Mat& dst) const;
+
+    // 全部清為 0；容量足夠時不重新配置
+    void create(int rows, int cols);
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    int words_per_row() const { return words_per_row_; }
+    bool empty() const { return rows_ == 0 || cols_ == 0; }
+
+    uint64_t* row(int y) { return bits_.data() + (size_t)y * words_per_row_; }
+    const uint64_t* row(int y) const { return bits_.data() + (size_t)y * words_per_row_; }
+
+    // 最後一個 word 中屬於影像的位元
+    uint64_t tail_mask() const;
+
+    bool get(int y, int x) const { return (row(y)[x >> 6] >> (x & 63)) & 1; }
+
+    // 前景像素數（popcount）
+    int64_t count() const;
+
+private:
+    int rows_ = 0;
+    int cols_ = 0;
+    int words_per_row_ = 0;
+    std::vector<uint64_t> bits_;
+};
+
+// 支援 MORPH_CROSS / MORPH_RECT 與奇數大小；其他形狀回傳 false
+bool bit_morph_supported(int kernel_shape, int kernel_size);
+
+// 以 word 的位移 / AND / OR 做腐蝕、膨脹；影像外視為單位元素，結果與 cv::erode / cv::dilate 相同
+void bit_erode(const BitMask& src, BitMask& dst, int kernel_shape, int kernel_size, int iterations = 1);
+void bit_dilate(const BitMask& src, BitMask& dst, int kernel_shape, int kernel_size, int iterations = 1);
+
+// 依序執行整串步驟（相鄰同類步驟合併）。中間結果放在每個執行緒一份的暫存中，穩態下不再配置；
+// dst 可與 src 相同
+void run_bit_morphology(const std::vector<MorphStep>& steps, int kernel_shape, int kernel_size,
+                        const BitMask& src, BitMask& dst);
+
+} // namespace droplet
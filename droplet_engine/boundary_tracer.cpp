@@ -0,0 +1,246 @@
+#include "droplet_engine/boundary_tracer.hpp"
+#include "droplet_engine/convex_hull.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+namespace droplet {
+
+namespace {
+
+// 標記值：0 背景、1 未走過的前景、2 走過的外框、3 走過且右側為背景的外框（離開物體的位置）
+const uchar kForeground = 1;
+const uchar kVisited = 2;
+const uchar kExit = 3;
+
+// OpenCV 的鏈碼方向：0 = 右，逆時針遞增（y 向下）
+const int kDx[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+const int kDy[8] = { 0, -1, -1, -1, 0, 1, 1, 1 };
+
+// marks 的四周多補一圈 0，對應 findContours 內部的 copyMakeBorder
+class MarkImage {
+public:
+    MarkImage(const cv::Mat& binary, std::vector<uchar>& data)
+        : width_(binary.cols), height_(binary.rows), step_(binary.cols + 2), data_(data) {
+        data_.assign((size_t)(binary.rows + 2) * (binary.cols + 2), 0);
+        for (int y = 0; y < height_; ++y) {
+            const uchar* src = binary.ptr<uchar>(y);
+            uchar* dst = at(0, y);
+            for (int x = 0; x < width_; ++x) {
+                dst[x] = src[x] ? kForeground : 0;
+            }
+        }
+    }
+
+    uchar* at(int x, int y) { return data_.data() + (size_t)(y + 1) * step_ + (x + 1); }
+
+private:
+    int width_, height_, step_;
+    std::vector<uchar>& data_;
+};
+
+class ContourAccumulator {
+public:
+    ContourAccumulator(TracedContour& out, std::vector<cv::Point>* points, cv::Size size)
+        : out_(out), points_(points), size_(size) {}
+
+    void add(int x, int y) {
+        if (out_.point_count == 0) {
+            first_ = cv::Point(x, y);
+            min_ = max_ = first_;
+        } else {
+            step_to(x, y);
+        }
+        last_ = cv::Point(x, y);
+        min_.x = std::min(min_.x, x);
+        min_.y = std::min(min_.y, y);
+        max_.x = std::max(max_.x, x);
+        max_.y = std::max(max_.y, y);
+        ++out_.point_count;
+        if (points_) {
+            points_->push_back(last_);
+        }
+    }
+
+    void finish(cv::Point offset) {
+        if (out_.point_count > 1) {
+            step_to(first_.x, first_.y);
+        }
+        out_.area = std::abs((double)twice_area_) * 0.5;
+        out_.perimeter = straight_ + diagonal_ * std::sqrt(2.0);
+        out_.bbox = cv::Rect(min_.x + offset.x, min_.y + offset.y, max_.x - min_.x + 1, max_.y - min_.y + 1);
+        out_.touches_border = min_.x <= 0 || min_.y <= 0 || max_.x >= size_.width - 1 || max_.y >= size_.height - 1;
+    }
+
+private:
+    void step_to(int x, int y) {
+        twice_area_ += (int64_t)last_.x * y - (int64_t)x * last_.y;
+        if (x != last_.x && y != last_.y) {
+            ++diagonal_;
+        } else {
+            ++straight_;
+        }
+    }
+
+    TracedContour& out_;
+    std::vector<cv::Point>* points_;
+    cv::Size size_;
+    cv::Point first_, last_, min_, max_;
+    int64_t twice_area_ = 0;
+    int64_t straight_ = 0;
+    int64_t diagonal_ = 0;
+};
+
+// 追蹤中的輪廓、點與沒有外部緩衝時的標記影像，每個執行緒一份。
+// 與 summary.largest 交換時點的容量在兩者之間循環，不會釋放
+struct TraceScratch {
+    TracedContour current;
+    std::vector<cv::Point> points;
+    std::vector<uchar> marks;
+    std::vector<cv::Point> hull;    // measure_traced_contour 的凸包頂點
+};
+
+thread_local TraceScratch tls_trace;
+
+// 清為初始值，保留點的容量
+void restart(TracedContour& contour) {
+    std::vector<cv::Point> points = std::move(contour.points);
+    points.clear();
+    contour = TracedContour();
+    contour.points = std::move(points);
+}
+
+// Suzuki-Abe 外框追蹤（icvTraceContour 的做法），起點 (x0, y0) 左側為背景
+void trace_outer_border(MarkImage& marks, int x0, int y0, ContourAccumulator& acc) {
+    // 從左方開始順時針找第一個前景鄰點
+    int s = 4, s_end = 4;
+    int x1 = 0, y1 = 0;
+    do {
+        s = (s - 1) & 7;
+        x1 = x0 + kDx[s];
+        y1 = y0 + kDy[s];
+    } while (*marks.at(x1, y1) == 0 && s != s_end);
+
+    if (s == s_end && *marks.at(x1, y1) == 0) {
+        // 孤立點
+        *marks.at(x0, y0) = kExit;
+        acc.add(x0, y0);
+        return;
+    }
+
+    int x3 = x0, y3 = y0;
+    for (;;) {
+        // 以前一點的方向為起點逆時針找下一個前景鄰點
+        s_end = s;
+        int k = 1, x4 = 0, y4 = 0;
+        for (; k <= 8; ++k) {
+            int d = (s_end + k) & 7;
+            x4 = x3 + kDx[d];
+            y4 = y3 + kDy[d];
+            if (*marks.at(x4, y4) != 0) {
+                break;
+            }
+        }
+        s = (s_end + k) & 7;
+
+        // 搜尋經過右方且右方為背景：此點是離開物體的位置
+        uchar* m3 = marks.at(x3, y3);
+        if (s_end != 0 && k > 8 - s_end) {
+            *m3 = kExit;
+        } else if (*m3 == kForeground) {
+            *m3 = kVisited;
+        }
+        acc.add(x3, y3);
+
+        if (x4 == x0 && y4 == y0 && x3 == x1 && y3 == y1) {
+            break;
+        }
+        x3 = x4;
+        y3 = y4;
+        s = (s + 4) & 7;
+    }
+}
+
+} // namespace
+
+TraceSummary trace_external_contours(const cv::Mat& binary, bool keep_points, cv::Point offset,
+                                     std::vector<uchar>* mark_buffer) {
+    TraceSummary summary;
+    trace_external_contours(binary, summary, keep_points, offset, mark_buffer);
+    return summary;
+}
+
+void trace_external_contours(const cv::Mat& binary, TraceSummary& summary, bool keep_points, cv::Point offset,
+                             std::vector<uchar>* mark_buffer) {
+    CV_Assert(binary.type() == CV_8UC1);
+    TraceScratch& tls = tls_trace;
+    MarkImage marks(binary, mark_buffer ? *mark_buffer : tls.marks);
+    summary.count = 0;
+    restart(summary.largest);
+
+    TracedContour& current = tls.current;
+    std::vector<cv::Point>& scratch = tls.points;
+
+    for (int y = 0; y < binary.rows; ++y) {
+        uchar prev = 0;
+        // 最近經過的已標記外框；kVisited 表示目前在某個外輪廓內部
+        uchar last_border = 0;
+        for (int x = 0; x < binary.cols; ++x) {
+            uchar p = *marks.at(x, y);
+            if (p == prev) {
+                continue;
+            }
+            if (prev == 0 && p == kForeground && last_border != kVisited) {
+                restart(current);
+                scratch.clear();
+                ContourAccumulator acc(current, keep_points ? &scratch : nullptr, binary.size());
+                trace_outer_border(marks, x, y, acc);
+                acc.finish(offset);
+
+                ++summary.count;
+                if (summary.count == 1 || current.area > summary.largest.area) {
+                    if (keep_points) {
+                        for (cv::Point& point : scratch) {
+                            point += offset;
+                        }
+                        std::swap(current.points, scratch);
+                    }
+                    std::swap(summary.largest, current);
+                }
+                p = *marks.at(x, y);
+            }
+            prev = p;
+            if (p >= kVisited) {
+                last_border = p;
+            }
+        }
+    }
+}
+
+ContourMetrics measure_traced_contour(const TracedContour& contour, const MetricsOptions& options,
+                                      PointArena* arena) {
+    if (contour.point_count == 0) {
+        return ContourMetrics();
+    }
+    CV_Assert((int)contour.points.size() == contour.point_count);
+    if (options.reject_degenerate && (contour.area <= 1e-6 || contour.perimeter <= 1e-6)) {
+        ContourMetrics rejected;
+        rejected.status = FrameStatus::InvalidMeasurement;
+        return rejected;
+    }
+
+    std::vector<cv::Point>& hull = tls_trace.hull;
+    HullMetrics hull_metrics = contour_hull(contour.points, options.keep_points ? &hull : nullptr);
+
+    ContourMetrics results = make_contour_metrics(contour.area, contour.perimeter,
+                                                  hull_metrics.area, hull_metrics.perimeter, options);
+    if (results.ok() && options.keep_points) {
+        store_points(results, PointSpan(contour.points.data(), contour.points.size()),
+                     PointSpan(hull.data(), hull.size()), arena);
+    }
+    return results;
+}
+
+} // namespace droplet
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "droplet_engine/contour_metrics.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace droplet {
+
+// 沿外輪廓走一次累加的量測值，定義與 contourArea / arcLength(closed) / boundingRect 相同
+struct TracedContour {
+    double area = 0;
+    double perimeter = 0;
+    cv::Rect bbox;
+    // 是否碰到追蹤影像的邊界（等同 !is_contour_complete）
+    bool touches_border = false;
+    int point_count = 0;
+    // 只有要求保存點時才會填入（CHAIN_APPROX_NONE 的順序）
+    std::vector<cv::Point> points;
+};
+
+struct TraceSummary {
+    int count = 0;              // 外輪廓數量（RETR_EXTERNAL）
+    TracedContour largest;      // 面積最大的外輪廓
+};
+
+// 與 findContours(RETR_EXTERNAL, CHAIN_APPROX_NONE) 相同的 Suzuki 外框追蹤，
+// 但不產生 vector<vector<Point>>：每個輪廓邊走邊累加，只保留目前最大者。
+// keep_points = false 時連最大輪廓的點也不保存（裁切只需要數量與外框）。
+// offset 加在點與 bbox 上，與 findContours 的 offset 參數相同。
+// mark_buffer 不為 nullptr 時標記影像放在其中，重複使用時不再配置。
+TraceSummary trace_external_contours(const cv::Mat& binary, bool keep_points = true, cv::Point offset = cv::Point(),
+                                     std::vector<uchar>* mark_buffer = nullptr);
+
+// 同上，結果寫入 summary；重複使用同一個 summary 時點的容量保留（PipelineWorkspace::trace），
+// 追蹤中的暫存每個執行緒一份，穩態下不再配置
+void trace_external_contours(const cv::Mat& binary, TraceSummary& summary, bool keep_points = true,
+                             cv::Point offset = cv::Point(), std::vector<uchar>* mark_buffer = nullptr);
+
+// 以追蹤結果計算指標；凸包使用 contour.points，點存進 arena（nullptr 時由結果自己持有）
+ContourMetrics measure_traced_contour(const TracedContour& contour, const MetricsOptions& options = MetricsOptions(),
+                                      PointArena* arena = nullptr);
+
+} // namespace droplet
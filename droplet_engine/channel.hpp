@@ -0,0 +1,278 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace droplet {
+
+namespace detail {
+
+// 佇列滿 / 空時的等待：先短暫自旋，之後才用 condition_variable 睡眠。
+// 通知端只有在確實有人睡著時才鎖 mutex，平常的 push / pop 不碰鎖。
+class ChannelParking {
+public:
+    template <typename Ready>
+    void wait(Ready ready) {
+        for (int i = 0; i < kSpins; ++i) {
+            if (ready()) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+        sleepers_.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, ready);
+        }
+        sleepers_.fetch_sub(1);
+    }
+
+    void notify() {
+        // 與 wait 中的 fetch_add 配對（Dekker）：不是看到睡著的人，就是對方看到新狀態
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers_.load() > 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cv_.notify_all();
+        }
+    }
+
+private:
+    static const int kSpins = 64;
+    std::atomic<int> sleepers_{ 0 };
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+inline size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+// 阻塞、批次與 close 的共同部分；Derived 提供不阻塞的 try_push / try_pop
+template <typename Derived, typename T>
+class ChannelBase {
+public:
+    // 佇列滿時阻塞（背壓）；close 之後回傳 false
+    bool push(T value) {
+        for (;;) {
+            if (closed()) {
+                return false;
+            }
+            if (self().try_push(value)) {
+                not_empty_.notify();
+                return true;
+            }
+            not_full_.wait([this]() { return closed() || self().can_push(); });
+        }
+    }
+
+    // 佇列空時阻塞；close 且取完後回傳 false
+    bool pop(T& value) {
+        for (;;) {
+            if (self().try_pop(value)) {
+                not_full_.notify();
+                return true;
+            }
+            if (closed()) {
+                // close 之前推入的最後幾筆
+                if (self().try_pop(value)) {
+                    not_full_.notify();
+                    return true;
+                }
+                return false;
+            }
+            not_empty_.wait([this]() { return closed() || self().can_pop(); });
+        }
+    }
+
+    // 依序推入全部（必要時等待），回傳實際推入的數量（close 時可能較少）
+    size_t push_batch(std::vector<T>& values) {
+        size_t pushed = 0;
+        while (pushed < values.size()) {
+            if (closed()) {
+                break;
+            }
+            size_t before = pushed;
+            while (pushed < values.size() && self().try_push(values[pushed])) {
+                ++pushed;
+            }
+            if (pushed > before) {
+                not_empty_.notify();
+            } else {
+                not_full_.wait([this]() { return closed() || self().can_push(); });
+            }
+        }
+        return pushed;
+    }
+
+    // 等到至少一筆後，一次取出最多 max_count 筆；close 且取完後回傳 0
+    size_t pop_batch(std::vector<T>& values, size_t max_count) {
+        values.clear();
+        T value;
+        if (max_count == 0 || !pop(value)) {
+            return 0;
+        }
+        values.push_back(std::move(value));
+        while (values.size() < max_count && self().try_pop(value)) {
+            values.push_back(std::move(value));
+        }
+        not_full_.notify();
+        return values.size();
+    }
+
+    // 之後的 push 失敗；pop 取完剩下的資料後回傳 false。喚醒所有等待者
+    void close() {
+        closed_.store(true);
+        not_empty_.notify();
+        not_full_.notify();
+    }
+
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+private:
+    Derived& self() { return static_cast<Derived&>(*this); }
+
+    std::atomic<bool> closed_{ false };
+    ChannelParking not_empty_;
+    ChannelParking not_full_;
+};
+
+} // namespace detail
+
+// 單一生產者、單一消費者的固定容量環形緩衝；各自快取對方的索引，減少 cache line 往返
+template <typename T>
+class SpscChannel : public detail::ChannelBase<SpscChannel<T>, T> {
+public:
+    explicit SpscChannel(size_t capacity)
+        : mask_(detail::round_up_pow2(capacity < 1 ? 1 : capacity) - 1), buffer_(mask_ + 1) {}
+
+    size_t capacity() const { return mask_ + 1; }
+
+    bool try_push(T& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ > mask_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ > mask_) {
+                return false;
+            }
+        }
+        buffer_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) {
+                return false;
+            }
+        }
+        value = std::move(buffer_[head & mask_]);
+        buffer_[head & mask_] = T();   // 立刻釋放 Mat 等資源，不留在環中
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool can_push() const {
+        return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_acquire) <= mask_;
+    }
+    bool can_pop() const {
+        return head_.load(std::memory_order_relaxed) != tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    const size_t mask_;
+    std::vector<T> buffer_;
+    alignas(64) std::atomic<size_t> head_{ 0 };     // 消費者寫
+    size_t tail_cache_ = 0;
+    alignas(64) std::atomic<size_t> tail_{ 0 };     // 生產者寫
+    size_t head_cache_ = 0;
+};
+
+// 多生產者、多消費者的固定容量環形緩衝（Vyukov）：每格帶序號，以 CAS 搶位置，不用鎖
+template <typename T>
+class MpmcChannel : public detail::ChannelBase<MpmcChannel<T>, T> {
+public:
+    explicit MpmcChannel(size_t capacity)
+        : mask_(detail::round_up_pow2(capacity < 2 ? 2 : capacity) - 1), cells_(new Cell[mask_ + 1]) {
+        for (size_t i = 0; i <= mask_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    bool try_push(T& value) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(T& value) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.value);
+                    cell.value = T();
+                    cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool can_push() const {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        return cells_[pos & mask_].sequence.load(std::memory_order_acquire) == pos;
+    }
+    bool can_pop() const {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        return cells_[pos & mask_].sequence.load(std::memory_order_acquire) == pos + 1;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<size_t> tail_{ 0 };
+    alignas(64) std::atomic<size_t> head_{ 0 };
+};
+
+} // namespace droplet
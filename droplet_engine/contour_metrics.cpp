@@ -0,0 +1,127 @@
+#include "droplet_engine/contour_metrics.hpp"
+#include "droplet_engine/convex_hull.hpp"
+
+#include <cmath>
+
+namespace droplet {
+
+namespace {
+
+// 凸包頂點在存進 arena 前的暫存，每個執行緒一份
+thread_local std::vector<cv::Point> tls_hull_points;
+
+} // namespace
+
+double circularity(double area, double perimeter, CircularityFormula formula) {
+    if (perimeter <= 0) {
+        return 0;
+    }
+    if (formula == CircularityFormula::Isoperimetric) {
+        return 4 * CV_PI * area / (perimeter * perimeter);
+    }
+    return 2 * std::sqrt(CV_PI * area) / perimeter;
+}
+
+void ContourMetrics::detach() {
+    if (storage) {
+        return;
+    }
+    store_points(*this, contour, hull, nullptr);
+}
+
+void ContourMetrics::detach(PointArena& arena) {
+    store_points(*this, contour, hull, &arena);
+}
+
+ContourMetrics calculate_contour_metrics(const std::vector<std::vector<cv::Point>>& contours,
+                                         const MetricsOptions& options, PointArena* arena) {
+    if (contours.empty()) {
+        return ContourMetrics();
+    }
+
+    // 每個輪廓只算一次面積
+    size_t largest = 0;
+    double largest_area = -1;
+    for (size_t i = 0; i < contours.size(); ++i) {
+        double area = cv::contourArea(contours[i]);
+        if (area > largest_area) {
+            largest_area = area;
+            largest = i;
+        }
+    }
+
+    return calculate_contour_metrics(contours[largest], options, arena);
+}
+
+ContourMetrics calculate_contour_metrics(const std::vector<cv::Point>& contour,
+                                         const MetricsOptions& options, PointArena* arena) {
+    ContourMetrics results;
+    if (contour.empty()) {
+        return results;
+    }
+
+    double area_original = cv::contourArea(contour);
+    double perimeter_original = cv::arcLength(contour, true);
+
+    if (options.reject_degenerate && (area_original <= 1e-6 || perimeter_original <= 1e-6)) {
+        results.status = FrameStatus::InvalidMeasurement;
+        return results;
+    }
+
+    std::vector<cv::Point>& hull = tls_hull_points;
+    HullMetrics hull_metrics = contour_hull(contour, options.keep_points ? &hull : nullptr);
+
+    results = make_contour_metrics(area_original, perimeter_original, hull_metrics.area, hull_metrics.perimeter, options);
+    if (!results.ok()) {
+        return results;
+    }
+
+    if (options.keep_points) {
+        store_points(results, PointSpan(contour.data(), contour.size()), PointSpan(hull.data(), hull.size()), arena);
+    }
+
+    return results;
+}
+
+ContourMetrics make_contour_metrics(double area_original, double perimeter_original,
+                                    double area_hull, double perimeter_hull, const MetricsOptions& options) {
+    ContourMetrics results;
+    if (options.reject_degenerate && (area_original <= 1e-6 || perimeter_original <= 1e-6 ||
+                                      area_hull <= 1e-6 || perimeter_hull <= 1e-6)) {
+        results.status = FrameStatus::InvalidMeasurement;
+        return results;
+    }
+
+    results.area_original = area_original;
+    results.area_hull = area_hull;
+    results.circularity_original = circularity(area_original, perimeter_original, options.circularity);
+    results.circularity_hull = circularity(area_hull, perimeter_hull, options.circularity);
+    results.area_ratio = area_original > 0 ? area_hull / area_original : 0;
+    results.circularity_ratio = results.circularity_original > 0
+        ? results.circularity_hull / results.circularity_original : 0;
+    results.status = FrameStatus::Ok;
+    return results;
+}
+
+void store_points(ContourMetrics& results, const PointSpan& contour, const PointSpan& hull, PointArena* arena) {
+    std::shared_ptr<PointArena> owned;
+    if (!arena) {
+        // 一個區塊剛好放下兩者
+        owned = std::make_shared<PointArena>(contour.size() + hull.size());
+        arena = owned.get();
+    }
+    results.contour = arena->store(contour);
+    results.hull = arena->store(hull);
+    results.storage = std::move(owned);
+}
+
+bool is_contour_complete(const std::vector<cv::Point>& contour, const cv::Size& image_size) {
+    for (const cv::Point& point : contour) {
+        if (point.x <= 0 || point.y <= 0 || point.x >= image_size.width - 1 || point.y >= image_size.height - 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace droplet
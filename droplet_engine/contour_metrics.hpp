@@ -0,0 +1,78 @@
+#pragma once
+
+#include "droplet_engine/point_arena.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <vector>
+
+namespace droplet {
+
+// 圓度公式：各版本原本寫法不同，保留兩種
+enum class CircularityFormula {
+    SqrtRatio,      // 2 * sqrt(pi * A) / P
+    Isoperimetric   // 4 * pi * A / P^2
+};
+
+// 每張影像的處理結果狀態
+enum class FrameStatus {
+    Ok,
+    NoContour,
+    MultipleContours,
+    IncompleteContour,
+    InvalidMeasurement
+};
+
+struct ContourMetrics {
+    double area_original = 0;
+    double area_hull = 0;
+    double area_ratio = 0;
+    double circularity_original = 0;
+    double circularity_hull = 0;
+    double circularity_ratio = 0;
+    // 輪廓與凸包點放在 PointArena 中。量測時傳入 arena（每個 worker 一個）時指向該 arena，
+    // 同一個 arena reset（處理下一張影像）後失效；沒有 arena 時由 storage 持有，複製結果只增加參考計數
+    PointSpan contour;
+    PointSpan hull;
+    std::shared_ptr<const PointArena> storage;
+    FrameStatus status = FrameStatus::NoContour;
+
+    bool ok() const { return status == FrameStatus::Ok; }
+    // 把點複製到結果自己的 storage；結果要保留到 arena reset 之後時呼叫。每次配置一個新的 arena
+    void detach();
+    // 把點複製到呼叫端持有、不隨影像 reset 的 arena（例如每個 worker 一個結果 arena），
+    // 只在 arena 的區塊用完時配置；結果在該 arena reset 或釋放前有效
+    void detach(PointArena& arena);
+};
+
+struct MetricsOptions {
+    CircularityFormula circularity = CircularityFormula::SqrtRatio;
+    // 面積或周長 <= 1e-6 時整筆結果視為無效（原始線性流程的檢查）
+    bool reject_degenerate = false;
+    // 是否把輪廓與凸包點存進結果（畫圖用）
+    bool keep_points = true;
+};
+
+double circularity(double area, double perimeter, CircularityFormula formula);
+
+// 從多個輪廓中取面積最大者計算指標；keep_points 時點存進 arena（nullptr 時由結果自己持有）
+ContourMetrics calculate_contour_metrics(const std::vector<std::vector<cv::Point>>& contours,
+                                         const MetricsOptions& options = MetricsOptions(),
+                                         PointArena* arena = nullptr);
+
+// 單一輪廓版本
+ContourMetrics calculate_contour_metrics(const std::vector<cv::Point>& contour,
+                                         const MetricsOptions& options = MetricsOptions(),
+                                         PointArena* arena = nullptr);
+
+// 由面積與周長組合結果（findContours 與 run-length 量測共用）
+ContourMetrics make_contour_metrics(double area_original, double perimeter_original,
+                                    double area_hull, double perimeter_hull, const MetricsOptions& options);
+
+// 把輪廓與凸包點存進結果（各量測函式共用）；arena 為 nullptr 時配置結果自己的 storage
+void store_points(ContourMetrics& results, const PointSpan& contour, const PointSpan& hull, PointArena* arena);
+
+// 輪廓是否碰到影像邊界
+bool is_contour_complete(const std::vector<cv::Point>& contour, const cv::Size& image_size);
+
+} // namespace droplet
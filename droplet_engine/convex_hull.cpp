@@ -0,0 +1,161 @@
+#include "droplet_engine/convex_hull.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace droplet {
+
+namespace {
+
+// 每個執行緒一份，只會變大；穩態下每次求凸包不再配置
+struct HullScratch {
+    std::vector<cv::Point> candidates;
+    std::vector<cv::Point> stack;
+    std::vector<int> left, right;
+};
+
+thread_local HullScratch tls_hull;
+
+inline int64_t orientation(const cv::Point& a, const cv::Point& b, const cv::Point& c) {
+    return (int64_t)(b.x - a.x) * (c.y - a.y) - (int64_t)(b.y - a.y) * (c.x - a.x);
+}
+
+// 單調鏈的堆疊（放在呼叫端的緩衝中）；相鄰兩點的叉積與邊長隨推入 / 彈出增減
+class HullStack {
+public:
+    HullStack(std::vector<cv::Point>& storage, size_t capacity) : points_(storage) {
+        points_.clear();
+        points_.reserve(capacity);
+    }
+
+    size_t size() const { return points_.size(); }
+    const cv::Point& back(size_t i = 0) const { return points_[points_.size() - 1 - i]; }
+
+    void push(const cv::Point& p) {
+        if (!points_.empty()) {
+            add_edge(points_.back(), p, 1);
+        }
+        points_.push_back(p);
+    }
+
+    void pop() {
+        cv::Point p = points_.back();
+        points_.pop_back();
+        if (!points_.empty()) {
+            add_edge(points_.back(), p, -1);
+        }
+    }
+
+    // 最後推入的點與第一點相同，凸包已封閉
+    HullMetrics metrics() const {
+        HullMetrics m;
+        m.area = std::abs((double)twice_area_) * 0.5;
+        m.perimeter = perimeter_;
+        return m;
+    }
+
+    void copy_to(std::vector<cv::Point>& hull) const {
+        hull.assign(points_.begin(), points_.end() - 1);
+    }
+
+private:
+    void add_edge(const cv::Point& a, const cv::Point& b, int sign) {
+        twice_area_ += sign * ((int64_t)a.x * b.y - (int64_t)b.x * a.y);
+        double dx = b.x - a.x;
+        double dy = b.y - a.y;
+        perimeter_ += sign * std::sqrt(dx * dx + dy * dy);
+    }
+
+    std::vector<cv::Point>& points_;
+    int64_t twice_area_ = 0;
+    double perimeter_ = 0;
+};
+
+// 依 (y, x) 排序的候選點建立凸包
+HullMetrics monotone_chain(const std::vector<cv::Point>& sorted, std::vector<cv::Point>* hull) {
+    size_t n = sorted.size();
+    if (n == 1) {
+        if (hull) {
+            hull->assign(1, sorted[0]);
+        }
+        return HullMetrics();
+    }
+
+    HullStack stack(tls_hull.stack, 2 * n);
+    for (size_t i = 0; i < n; ++i) {
+        while (stack.size() >= 2 && orientation(stack.back(1), stack.back(), sorted[i]) <= 0) {
+            stack.pop();
+        }
+        stack.push(sorted[i]);
+    }
+    size_t lower = stack.size() + 1;
+    for (size_t i = n - 1; i > 0; --i) {
+        while (stack.size() >= lower && orientation(stack.back(1), stack.back(), sorted[i - 1]) <= 0) {
+            stack.pop();
+        }
+        stack.push(sorted[i - 1]);
+    }
+
+    if (hull) {
+        stack.copy_to(*hull);
+    }
+    return stack.metrics();
+}
+
+} // namespace
+
+HullMetrics contour_hull(const std::vector<cv::Point>& points, std::vector<cv::Point>* hull) {
+    if (hull) {
+        hull->clear();
+    }
+    if (points.empty()) {
+        return HullMetrics();
+    }
+
+    int min_y = INT_MAX, max_y = INT_MIN;
+    for (const cv::Point& p : points) {
+        min_y = std::min(min_y, p.y);
+        max_y = std::max(max_y, p.y);
+    }
+
+    HullScratch& scratch = tls_hull;
+    std::vector<cv::Point>& candidates = scratch.candidates;
+    candidates.clear();
+    size_t rows = (size_t)((int64_t)max_y - min_y + 1);
+    if (rows <= 2 * points.size()) {
+        // 凸包頂點只會是某一列的最左或最右點
+        std::vector<int>& left = scratch.left;
+        std::vector<int>& right = scratch.right;
+        left.assign(rows, INT_MAX);
+        right.assign(rows, INT_MIN);
+        for (const cv::Point& p : points) {
+            size_t r = p.y - min_y;
+            left[r] = std::min(left[r], p.x);
+            right[r] = std::max(right[r], p.x);
+        }
+        candidates.reserve(2 * rows);
+        for (size_t r = 0; r < rows; ++r) {
+            if (left[r] == INT_MAX) {
+                continue;
+            }
+            candidates.emplace_back(left[r], min_y + (int)r);
+            if (right[r] != left[r]) {
+                candidates.emplace_back(right[r], min_y + (int)r);
+            }
+        }
+    } else {
+        // 稀疏的折線（例如 CHAIN_APPROX_SIMPLE）點數少，直接排序
+        candidates.assign(points.begin(), points.end());
+        std::sort(candidates.begin(), candidates.end(), [](const cv::Point& a, const cv::Point& b) {
+            return a.y < b.y || (a.y == b.y && a.x < b.x);
+        });
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    }
+
+    return monotone_chain(candidates, hull);
+}
+
+} // namespace droplet
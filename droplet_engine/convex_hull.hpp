@@ -0,0 +1,21 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace droplet {
+
+struct HullMetrics {
+    double area = 0;
+    double perimeter = 0;   // 封閉凸包的周長（arcLength(hull, true)）
+};
+
+// 輪廓點的凸包，O(n)：先取每列最左、最右的點（已依列排序，免排序），
+// 再以單調鏈建立凸包；面積與周長在推入 / 彈出時增量維護，
+// 不再呼叫 contourArea(hull) / arcLength(hull)。
+// 像素輪廓常會沿細枝原路折返（非簡單折線），Melkman 在這種輸入上會漏掉頂點，因此不用。
+// hull 非空指標時輸出凸包頂點（與 convexHull 同樣不含共線點）；中間暫存每個執行緒一份，
+// hull 重複使用時穩態下不再配置。
+HullMetrics contour_hull(const std::vector<cv::Point>& points, std::vector<cv::Point>* hull = nullptr);
+
+} // namespace droplet
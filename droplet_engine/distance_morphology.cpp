@@ -0,0 +1,268 @@
+#include "droplet_engine/distance_morphology.hpp"
+#include "droplet_engine/threading_policy.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+namespace droplet {
+
+namespace {
+
+// Euclidean 的垂直掃描以欄帶分段平行；每帶內仍逐列讀寫連續記憶體
+const int kColumnBand = 256;
+
+struct EnvelopeScratch {
+    std::vector<int64_t> g2;    // 本列各欄的垂直平方距離
+    std::vector<int> s, t;      // 下包絡線的拋物線頂點與起點
+};
+
+thread_local EnvelopeScratch tls_envelope;
+
+template<class T>
+T* ensure(std::vector<T>& buffer, size_t size) {
+    if (buffer.size() < size) {
+        buffer.resize(size);
+    }
+    return buffer.data();
+}
+
+// 目標像素為 0，其他為 far
+void init_targets(const cv::Mat& binary, cv::Mat& dist, DistanceField::Target target, int far) {
+    bool want_foreground = target == DistanceField::Foreground;
+    for (int y = 0; y < binary.rows; ++y) {
+        const uchar* b = binary.ptr<uchar>(y);
+        int* d = dist.ptr<int>(y);
+        for (int x = 0; x < binary.cols; ++x) {
+            d[x] = ((b[x] != 0) == want_foreground) ? 0 : far;
+        }
+    }
+}
+
+// 兩次掃描的 chamfer：每列先與上一列（或下一列）合併，再做一次水平掃描。
+// 單位權重的 4 / 8 鄰域遮罩在無障礙的格點上得到精確的 L1 / L∞ 距離
+void chamfer(cv::Mat& dist, bool diagonal, int far) {
+    int rows = dist.rows, cols = dist.cols;
+    for (int y = 0; y < rows; ++y) {
+        int* d = dist.ptr<int>(y);
+        if (y > 0) {
+            const int* up = dist.ptr<int>(y - 1);
+            for (int x = 0; x < cols; ++x) {
+                d[x] = std::min(d[x], up[x] + 1);
+            }
+            if (diagonal) {
+                for (int x = 1; x < cols; ++x) {
+                    d[x] = std::min(d[x], up[x - 1] + 1);
+                }
+                for (int x = 0; x + 1 < cols; ++x) {
+                    d[x] = std::min(d[x], up[x + 1] + 1);
+                }
+            }
+        }
+        for (int x = 1; x < cols; ++x) {
+            d[x] = std::min(d[x], d[x - 1] + 1);
+        }
+    }
+    for (int y = rows - 1; y >= 0; --y) {
+        int* d = dist.ptr<int>(y);
+        if (y + 1 < rows) {
+            const int* down = dist.ptr<int>(y + 1);
+            for (int x = 0; x < cols; ++x) {
+                d[x] = std::min(d[x], down[x] + 1);
+            }
+            if (diagonal) {
+                for (int x = 1; x < cols; ++x) {
+                    d[x] = std::min(d[x], down[x - 1] + 1);
+                }
+                for (int x = 0; x + 1 < cols; ++x) {
+                    d[x] = std::min(d[x], down[x + 1] + 1);
+                }
+            }
+        }
+        for (int x = cols - 2; x >= 0; --x) {
+            d[x] = std::min(d[x], d[x + 1] + 1);
+        }
+        // 下一列已用完這一列；沒有目標的像素改為 INT_MAX
+        if (y + 1 < rows) {
+            int* below = dist.ptr<int>(y + 1);
+            for (int x = 0; x < cols; ++x) {
+                below[x] = below[x] >= far ? INT_MAX : below[x];
+            }
+        }
+    }
+    if (rows > 0) {
+        int* top = dist.ptr<int>(0);
+        for (int x = 0; x < cols; ++x) {
+            top[x] = top[x] >= far ? INT_MAX : top[x];
+        }
+    }
+}
+
+// 向下取整的整數除法（den > 0）
+int64_t floor_div(int64_t num, int64_t den) {
+    return num >= 0 ? num / den : -((-num + den - 1) / den);
+}
+
+// Meijster 等人的精確歐氏距離：先求每欄到最近目標的垂直距離，再對每列求拋物線 (x - i)² + g(i)² 的下包絡線
+void euclidean(cv::Mat& dist, int far) {
+    int rows = dist.rows, cols = dist.cols;
+    int pixels = rows * cols;
+
+    int bands = (cols + kColumnBand - 1) / kColumnBand;
+    #pragma omp parallel for if(parallel_within_frame(ParallelStage::Morphology, pixels))
+    for (int b = 0; b < bands; ++b) {
+        int x0 = b * kColumnBand;
+        int x1 = std::min(cols, x0 + kColumnBand);
+        for (int y = 1; y < rows; ++y) {
+            int* d = dist.ptr<int>(y);
+            const int* up = dist.ptr<int>(y - 1);
+            for (int x = x0; x < x1; ++x) {
+                d[x] = std::min(d[x], up[x] + 1);
+            }
+        }
+        for (int y = rows - 2; y >= 0; --y) {
+            int* d = dist.ptr<int>(y);
+            const int* down = dist.ptr<int>(y + 1);
+            for (int x = x0; x < x1; ++x) {
+                d[x] = std::min(d[x], down[x] + 1);
+            }
+        }
+    }
+
+    // far² 大於任何實際的平方距離；結果不小於 far² 表示整張影像沒有目標
+    const int64_t far2 = (int64_t)far * far;
+    #pragma omp parallel for schedule(dynamic, 16) if(parallel_within_frame(ParallelStage::Morphology, pixels))
+    for (int y = 0; y < rows; ++y) {
+        EnvelopeScratch& scratch = tls_envelope;
+        int64_t* g2 = ensure(scratch.g2, cols);
+        int* s = ensure(scratch.s, cols);
+        int* t = ensure(scratch.t, cols);
+        int* d = dist.ptr<int>(y);
+        for (int x = 0; x < cols; ++x) {
+            int64_t g = std::min(d[x], far);
+            g2[x] = g * g;
+        }
+
+        auto f = [&](int x, int i) { return (int64_t)(x - i) * (x - i) + g2[i]; };
+        int q = 0;
+        s[0] = 0;
+        t[0] = 0;
+        for (int u = 1; u < cols; ++u) {
+            while (q >= 0 && f(t[q], s[q]) > f(t[q], u)) {
+                --q;
+            }
+            if (q < 0) {
+                q = 0;
+                s[0] = u;
+            } else {
+                // 從 w 開始 u 比 s[q] 近
+                int i = s[q];
+                int64_t w = 1 + floor_div((int64_t)u * u - (int64_t)i * i + g2[u] - g2[i], 2 * (int64_t)(u - i));
+                if (w < cols) {
+                    ++q;
+                    s[q] = u;
+                    t[q] = (int)w;
+                }
+            }
+        }
+        for (int u = cols - 1; u >= 0; --u) {
+            int64_t v = f(u, s[q]);
+            d[u] = v >= far2 ? INT_MAX : (int)std::min<int64_t>(v, INT_MAX - 1);
+            if (u == t[q]) {
+                --q;
+            }
+        }
+    }
+}
+
+} // namespace
+
+void DistanceField::compute(const cv::Mat& binary, DistanceMetric metric, Target target) {
+    CV_Assert(binary.type() == CV_8UC1);
+    metric_ = metric;
+    target_ = target;
+    dist_.create(binary.size(), CV_32S);
+    if (binary.empty()) {
+        return;
+    }
+
+    // 比任何實際距離大，加 1 也不溢位
+    int far = binary.rows + binary.cols;
+    init_targets(binary, dist_, target, far);
+    if (metric == DistanceMetric::Euclidean) {
+        euclidean(dist_, far);
+    } else {
+        chamfer(dist_, metric == DistanceMetric::Chessboard, far);
+    }
+}
+
+void DistanceField::threshold(int radius, cv::Mat& dst) const {
+    CV_Assert(radius >= 0);
+    dst.create(dist_.size(), CV_8UC1);
+
+    int64_t limit = metric_ == DistanceMetric::Euclidean ? (int64_t)radius * radius : radius;
+    // INT_MAX 保留給沒有目標的像素：腐蝕時一律保留，膨脹時一律為 0
+    int bound = (int)std::min<int64_t>(limit, INT_MAX - 1);
+    bool erode = target_ == Background;
+    for (int y = 0; y < dist_.rows; ++y) {
+        const int* d = dist_.ptr<int>(y);
+        uchar* out = dst.ptr<uchar>(y);
+        if (erode) {
+            for (int x = 0; x < dist_.cols; ++x) {
+                out[x] = d[x] > bound ? 255 : 0;
+            }
+        } else {
+            for (int x = 0; x < dist_.cols; ++x) {
+                out[x] = d[x] <= bound ? 255 : 0;
+            }
+        }
+    }
+}
+
+bool distance_morph_kernel(int kernel_shape, int kernel_size, DistanceMetric& metric, int& radius) {
+    if (kernel_size <= 0 || kernel_size % 2 == 0) {
+        return false;
+    }
+    radius = kernel_size / 2;
+    switch (kernel_shape) {
+    case cv::MORPH_RECT:
+        metric = DistanceMetric::Chessboard;
+        return true;
+    case cv::MORPH_CROSS:
+        // 更大的十字是細長的十字，不是菱形
+        metric = DistanceMetric::CityBlock;
+        return kernel_size <= 3;
+    case cv::MORPH_ELLIPSE:
+        metric = DistanceMetric::Euclidean;
+        return true;
+    default:
+        return false;
+    }
+}
+
+void run_distance_morphology(const std::vector<MorphStep>& steps, DistanceMetric metric, int radius,
+                             const cv::Mat& src, cv::Mat& dst, DistanceField& field, cv::Mat& ping, cv::Mat& pong) {
+    CV_Assert(src.type() == CV_8UC1);
+    cv::Mat cur = src;
+    cv::Mat* buffers[2] = { &ping, &pong };
+    int next = 0;
+    size_t i = 0;
+    while (i < steps.size()) {
+        MorphOp op = steps[i].op;
+        int iterations = 0;
+        for (; i < steps.size() && steps[i].op == op; ++i) {
+            iterations += std::max(0, steps[i].iterations);
+        }
+        if (iterations == 0 || radius == 0) {
+            continue;
+        }
+        field.compute(cur, metric, op == MorphOp::Erode ? DistanceField::Background : DistanceField::Foreground);
+        field.threshold(iterations * radius, *buffers[next]);
+        cur = *buffers[next];
+        next ^= 1;
+    }
+    dst = cur;
+}
+
+} // namespace droplet
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "droplet_engine/morphology.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace droplet {
+
+// 距離的度量決定結構元素的形狀：半徑 r 的球
+enum class DistanceMetric {
+    Chessboard,     // L∞：(2r+1) x (2r+1) 正方形（MORPH_RECT）
+    CityBlock,      // L1：菱形（3x3 MORPH_CROSS 迭代 r 次）
+    Euclidean       // L2：dx² + dy² <= r² 的圓盤
+};
+
+// 二值影像（CV_8UC1，非 0 為前景）到最近目標像素的距離場。算一次之後，任何半徑的腐蝕或膨脹都只是一次門檻，
+// 每像素的成本與半徑無關；同一張影像掃過多個半徑時共用同一個距離場。
+// Chessboard / CityBlock 以兩次掃描的 chamfer 計算，Euclidean 以 Meijster 的可分離演算法求精確的平方距離。
+// 與 cv::erode / cv::dilate 的預設邊界值相同，只有影像內的像素算目標（影像外不影響結果）。
+// 緩衝重複使用；不可跨執行緒共用（PipelineWorkspace 每個 worker 一份）
+class DistanceField {
+public:
+    enum Target {
+        Background,     // 到最近背景的距離：門檻後為腐蝕
+        Foreground      // 到最近前景的距離：門檻後為膨脹
+    };
+
+    void compute(const cv::Mat& binary, DistanceMetric metric, Target target);
+
+    // Background：距離 > radius 的像素為 255；Foreground：距離 <= radius 的像素為 255。
+    // dst 大小、型別相同時直接覆寫
+    void threshold(int radius, cv::Mat& dst) const;
+
+    DistanceMetric metric() const { return metric_; }
+    Target target() const { return target_; }
+    // CV_32S；Euclidean 為平方距離，沒有目標的像素為 INT_MAX
+    const cv::Mat& distances() const { return dist_; }
+
+private:
+    cv::Mat dist_;
+    DistanceMetric metric_ = DistanceMetric::Chessboard;
+    Target target_ = Background;
+};
+
+// 結構元素對應的距離度量與半徑：奇數大小的 MORPH_RECT、3x3 MORPH_CROSS 與 cv::erode 逐位元相同（morphology_test 檢查）；
+// 奇數大小的 MORPH_ELLIPSE 近似為半徑 kernel_size / 2 的圓盤（getStructuringElement 的橢圓各列寬度四捨五入，
+// 與 dx² + dy² <= r² 不完全相同）。其他形狀回傳 false
+bool distance_morph_kernel(int kernel_shape, int kernel_size, DistanceMetric& metric, int& radius);
+
+// 依序執行整串步驟：相鄰的同類步驟合併成一次距離場（半徑相加，正方形與菱形仍與逐次迭代相同），
+// 每段的成本與半徑、迭代次數無關。開運算 / 閉運算的每一段各算一次距離場，共用 field 的緩衝。
+// 各段輪流寫入 ping / pong（與 src 同大小、不與 src 重疊，可為 ROI），dst 指向最後結果
+void run_distance_morphology(const std::vector<MorphStep>& steps, DistanceMetric metric, int radius,
+                             const cv::Mat& src, cv::Mat& dst, DistanceField& field, cv::Mat& ping, cv::Mat& pong);
+
+} // namespace droplet
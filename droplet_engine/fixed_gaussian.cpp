@@ -0,0 +1,345 @@
+#include "droplet_engine/fixed_gaussian.hpp"
+#include "droplet_engine/threading_policy.hpp"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DROPLET_X86 1
+#include <immintrin.h>
+#endif
+
+// GCC / Clang 需要在函式上標明指令集才能使用對應的 intrinsics；MSVC 不需要
+#if defined(__GNUC__)
+#define DROPLET_TARGET(isa) __attribute__((target(isa)))
+#else
+#define DROPLET_TARGET(isa)
+#endif
+
+namespace droplet {
+
+namespace {
+
+// 各列帶獨立從頭做水平掃描（多算 ksize - 1 列），帶與帶之間可以平行
+const int kBandRows = 64;
+
+// 係數為二項式係數 C(K - 1, k)，二維權重和為 4^(K - 1) = 2^shift。
+// 5x5 的加權和最大為 255 * 256 + 128 = 65408，水平與垂直都能放在 16 位元內
+template<int K>
+struct Binomial {
+    static_assert(K == 3 || K == 5, "only 3x3 and 5x5 kernels are supported");
+    static constexpr int radius = K / 2;
+    static constexpr int shift = 2 * (K - 1);
+    static constexpr int round = 1 << (shift - 1);
+    static constexpr int tap(int k) {
+        int c = 1;
+        for (int i = 0; i < k; ++i) {
+            c = c * (K - 1 - i) / (i + 1);
+        }
+        return c;
+    }
+};
+
+// 係數左右對稱：中心一項，其餘兩兩相加後再乘
+template<int K>
+void horizontal_scalar(const uchar* padded, ushort* dst, int x, int width) {
+    using B = Binomial<K>;
+    for (; x < width; ++x) {
+        const uchar* p = padded + x;
+        int s = B::tap(B::radius) * p[B::radius];
+        for (int k = 0; k < B::radius; ++k) {
+            s += B::tap(k) * (p[k] + p[K - 1 - k]);
+        }
+        dst[x] = (ushort)s;
+    }
+}
+
+template<int K>
+void vertical_scalar(const ushort* const* rows, uchar* dst, int x, int width) {
+    using B = Binomial<K>;
+    for (; x < width; ++x) {
+        int s = B::round + B::tap(B::radius) * rows[B::radius][x];
+        for (int k = 0; k < B::radius; ++k) {
+            s += B::tap(k) * (rows[k][x] + rows[K - 1 - k][x]);
+        }
+        dst[x] = (uchar)(s >> B::shift);
+    }
+}
+
+template<int K>
+void horizontal_baseline(const uchar* padded, ushort* dst, int width) {
+    using B = Binomial<K>;
+    int x = 0;
+#if CV_SIMD128
+    for (; x <= width - 8; x += 8) {
+        const uchar* p = padded + x;
+        cv::v_uint16x8 s = cv::v_mul_wrap(cv::v_load_expand(p + B::radius), cv::v_setall_u16(B::tap(B::radius)));
+        for (int k = 0; k < B::radius; ++k) {
+            s = s + cv::v_mul_wrap(cv::v_load_expand(p + k) + cv::v_load_expand(p + K - 1 - k),
+                                cv::v_setall_u16(B::tap(k)));
+        }
+        cv::v_store(dst + x, s);
+    }
+#endif
+    horizontal_scalar<K>(padded, dst, x, width);
+}
+
+template<int K>
+void vertical_baseline(const ushort* const* rows, uchar* dst, int width) {
+    using B = Binomial<K>;
+    int x = 0;
+#if CV_SIMD128
+    for (; x <= width - 8; x += 8) {
+        cv::v_uint16x8 s = cv::v_setall_u16(B::round)
+                         + cv::v_mul_wrap(cv::v_load(rows[B::radius] + x), cv::v_setall_u16(B::tap(B::radius)));
+        for (int k = 0; k < B::radius; ++k) {
+            s = s + cv::v_mul_wrap(cv::v_load(rows[k] + x) + cv::v_load(rows[K - 1 - k] + x), cv::v_setall_u16(B::tap(k)));
+        }
+        cv::v_pack_store(dst + x, s >> B::shift);
+    }
+#endif
+    vertical_scalar<K>(rows, dst, x, width);
+}
+
+#ifdef DROPLET_X86
+
+template<int K>
+DROPLET_TARGET("sse4.1") void horizontal_sse41(const uchar* padded, ushort* dst, int width) {
+    using B = Binomial<K>;
+    int x = 0;
+    for (; x <= width - 8; x += 8) {
+        const uchar* p = padded + x;
+        __m128i s = _mm_mullo_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(p + B::radius))),
+                                    _mm_set1_epi16(B::tap(B::radius)));
+        for (int k = 0; k < B::radius; ++k) {
+            __m128i pair = _mm_add_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(p + k))),
+                                         _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(p + K - 1 - k))));
+            s = _mm_add_epi16(s, _mm_mullo_epi16(pair, _mm_set1_epi16(B::tap(k))));
+        }
+        _mm_storeu_si128((__m128i*)(dst + x), s);
+    }
+    horizontal_scalar<K>(padded, dst, x, width);
+}
+
+template<int K>
+DROPLET_TARGET("sse4.1") void vertical_sse41(const ushort* const* rows, uchar* dst, int width) {
+    using B = Binomial<K>;
+    int x = 0;
+    for (; x <= width - 8; x += 8) {
+        __m128i s = _mm_add_epi16(_mm_set1_epi16(B::round),
+                                  _mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(rows[B::radius] + x)),
+                                                  _mm_set1_epi16(B::tap(B::radius))));
+        for (int k = 0; k < B::radius; ++k) {
+            __m128i pair = _mm_add_epi16(_mm_loadu_si128((const __m128i*)(rows[k] + x)),
+                                         _mm_loadu_si128((const __m128i*)(rows[K - 1 - k] + x)));
+            s = _mm_add_epi16(s, _mm_mullo_epi16(pair, _mm_set1_epi16(B::tap(k))));
+        }
+        s = _mm_srli_epi16(s, B::shift);
+        _mm_storel_epi64((__m128i*)(dst + x), _mm_packus_epi16(s, s));
+    }
+    vertical_scalar<K>(rows, dst, x, width);
+}
+
+template<int K>
+DROPLET_TARGET("avx2") void horizontal_avx2(const uchar* padded, ushort* dst, int width) {
+    using B = Binomial<K>;
+    int x = 0;
+    for (; x <= width - 16; x += 16) {
+        const uchar* p = padded + x;
+        __m256i s = _mm256_mullo_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p + B::radius))),
+                                       _mm256_set1_epi16(B::tap(B::radius)));
+        for (int k = 0; k < B::radius; ++k) {
+            __m256i pair = _mm256_add_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p + k))),
+                                            _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p + K - 1 - k))));
+            s = _mm256_add_epi16(s, _mm256_mullo_epi16(pair, _mm256_set1_epi16(B::tap(k))));
+        }
+        _mm256_storeu_si256((__m256i*)(dst + x), s);
+    }
+    horizontal_scalar<K>(padded, dst, x, width);
+}
+
+template<int K>
+DROPLET_TARGET("avx2") void vertical_avx2(const ushort* const* rows, uchar* dst, int width) {
+    using B = Binomial<K>;
+    int x = 0;
+    for (; x <= width - 16; x += 16) {
+        __m256i s = _mm256_add_epi16(_mm256_set1_epi16(B::round),
+                                     _mm256_mullo_epi16(_mm256_loadu_si256((const __m256i*)(rows[B::radius] + x)),
+                                                        _mm256_set1_epi16(B::tap(B::radius))));
+        for (int k = 0; k < B::radius; ++k) {
+            __m256i pair = _mm256_add_epi16(_mm256_loadu_si256((const __m256i*)(rows[k] + x)),
+                                            _mm256_loadu_si256((const __m256i*)(rows[K - 1 - k] + x)));
+            s = _mm256_add_epi16(s, _mm256_mullo_epi16(pair, _mm256_set1_epi16(B::tap(k))));
+        }
+        s = _mm256_srli_epi16(s, B::shift);
+        // packus 在兩個 128 位元 lane 內各自進行，先拆開再合併
+        _mm_storeu_si128((__m128i*)(dst + x),
+                         _mm_packus_epi16(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1)));
+    }
+    vertical_scalar<K>(rows, dst, x, width);
+}
+
+template<int K>
+DROPLET_TARGET("avx512bw") void horizontal_avx512(const uchar* padded, ushort* dst, int width) {
+    using B = Binomial<K>;
+    int x = 0;
+    for (; x <= width - 32; x += 32) {
+        const uchar* p = padded + x;
+        __m512i s = _mm512_mullo_epi16(_mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i*)(p + B::radius))),
+                                       _mm512_set1_epi16(B::tap(B::radius)));
+        for (int k = 0; k < B::radius; ++k) {
+            __m512i pair = _mm512_add_epi16(_mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i*)(p + k))),
+                                            _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i*)(p + K - 1 - k))));
+            s = _mm512_add_epi16(s, _mm512_mullo_epi16(pair, _mm512_set1_epi16(B::tap(k))));
+        }
+        _mm512_storeu_si512((void*)(dst + x), s);
+    }
+    horizontal_scalar<K>(padded, dst, x, width);
+}
+
+template<int K>
+DROPLET_TARGET("avx512bw") void vertical_avx512(const ushort* const* rows, uchar* dst, int width) {
+    using B = Binomial<K>;
+    int x = 0;
+    for (; x <= width - 32; x += 32) {
+        __m512i s = _mm512_add_epi16(_mm512_set1_epi16(B::round),
+                                     _mm512_mullo_epi16(_mm512_loadu_si512((const void*)(rows[B::radius] + x)),
+                                                        _mm512_set1_epi16(B::tap(B::radius))));
+        for (int k = 0; k < B::radius; ++k) {
+            __m512i pair = _mm512_add_epi16(_mm512_loadu_si512((const void*)(rows[k] + x)),
+                                            _mm512_loadu_si512((const void*)(rows[K - 1 - k] + x)));
+            s = _mm512_add_epi16(s, _mm512_mullo_epi16(pair, _mm512_set1_epi16(B::tap(k))));
+        }
+        s = _mm512_srli_epi16(s, B::shift);
+        // 結果不超過 255，直接截斷成 8 位元
+        _mm256_storeu_si256((__m256i*)(dst + x), _mm512_cvtepi16_epi8(s));
+    }
+    vertical_scalar<K>(rows, dst, x, width);
+}
+
+#endif // DROPLET_X86
+
+typedef void (*HorizontalFn)(const uchar* padded, ushort* dst, int width);
+typedef void (*VerticalFn)(const ushort* const* rows, uchar* dst, int width);
+
+// [0] 為 3x3，[1] 為 5x5
+struct RowKernels {
+    const char* name;
+    HorizontalFn horizontal[2];
+    VerticalFn vertical[2];
+};
+
+RowKernels select_kernels() {
+#ifdef DROPLET_X86
+    // checkHardwareSupport 也會反映 OPENCV_CPU_DISABLE 的設定
+    if (cv::checkHardwareSupport(CV_CPU_AVX_512BW)) {
+        return { "AVX-512BW", { horizontal_avx512<3>, horizontal_avx512<5> }, { vertical_avx512<3>, vertical_avx512<5> } };
+    }
+    if (cv::checkHardwareSupport(CV_CPU_AVX2)) {
+        return { "AVX2", { horizontal_avx2<3>, horizontal_avx2<5> }, { vertical_avx2<3>, vertical_avx2<5> } };
+    }
+    if (cv::checkHardwareSupport(CV_CPU_SSE4_1)) {
+        return { "SSE4.1", { horizontal_sse41<3>, horizontal_sse41<5> }, { vertical_sse41<3>, vertical_sse41<5> } };
+    }
+#endif
+    return { "baseline", { horizontal_baseline<3>, horizontal_baseline<5> },
+             { vertical_baseline<3>, vertical_baseline<5> } };
+}
+
+const RowKernels& row_kernels() {
+    static const RowKernels kernels = select_kernels();
+    return kernels;
+}
+
+struct BlurScratch {
+    std::vector<uchar> padded;      // 左右以 BORDER_REFLECT_101 補 ksize / 2 個像素
+    std::vector<ushort> ring;       // ksize 列水平結果
+};
+
+thread_local BlurScratch tls_scratch;
+
+template<class T>
+T* ensure(std::vector<T>& buffer, size_t size) {
+    if (buffer.size() < size) {
+        buffer.resize(size);
+    }
+    return buffer.data();
+}
+
+void pad_row(const uchar* src, int width, int r, uchar* padded) {
+    for (int i = 0; i < r; ++i) {
+        padded[i] = src[cv::borderInterpolate(i - r, width, cv::BORDER_REFLECT_101)];
+        padded[r + width + i] = src[cv::borderInterpolate(width + i, width, cv::BORDER_REFLECT_101)];
+    }
+    std::memcpy(padded + r, src, width);
+}
+
+void blur_band(const cv::Mat& src, cv::Mat& dst, int ksize, int y0, int y1, const RowKernels& kernels) {
+    int width = src.cols;
+    int height = src.rows;
+    int r = ksize / 2;
+    HorizontalFn horizontal = kernels.horizontal[ksize == 5];
+    VerticalFn vertical = kernels.vertical[ksize == 5];
+
+    BlurScratch& scratch = tls_scratch;
+    uchar* padded = ensure(scratch.padded, width + 2 * r);
+    ushort* ring = ensure(scratch.ring, (size_t)ksize * width);
+    // 來源列 sy 放在 sy % ksize，視窗內的列不會互相覆蓋
+    int ring_row[5] = { -1, -1, -1, -1, -1 };
+    const ushort* rows[5];
+
+    for (int y = y0; y < y1; ++y) {
+        for (int k = 0; k < ksize; ++k) {
+            int sy = cv::borderInterpolate(y - r + k, height, cv::BORDER_REFLECT_101);
+            int slot = sy % ksize;
+            ushort* slot_data = ring + (size_t)slot * width;
+            if (ring_row[slot] != sy) {
+                pad_row(src.ptr<uchar>(sy), width, r, padded);
+                horizontal(padded, slot_data, width);
+                ring_row[slot] = sy;
+            }
+            rows[k] = slot_data;
+        }
+        vertical(rows, dst.ptr<uchar>(y), width);
+    }
+}
+
+} // namespace
+
+bool fixed_gaussian_supported(const cv::Mat& src, int ksize) {
+    return src.type() == CV_8UC1 && (ksize == 3 || ksize == 5);
+}
+
+void fixed_gaussian_blur(const cv::Mat& src, cv::Mat& dst, int ksize) {
+    CV_Assert(fixed_gaussian_supported(src, ksize));
+    // 列帶會讀到其他帶已寫入的列，就地模糊時先複製輸入
+    cv::Mat input = src.data == dst.data ? src.clone() : src;
+    dst.create(input.size(), CV_8UC1);
+    if (input.empty()) {
+        return;
+    }
+
+    const RowKernels& kernels = row_kernels();
+    int bands = (input.rows + kBandRows - 1) / kBandRows;
+    #pragma omp parallel for schedule(dynamic) if(parallel_within_frame(ParallelStage::OpenCV, input.rows * input.cols))
+    for (int b = 0; b < bands; ++b) {
+        int y0 = b * kBandRows;
+        blur_band(input, dst, ksize, y0, std::min(input.rows, y0 + kBandRows), kernels);
+    }
+}
+
+void gaussian_blur(const cv::Mat& src, cv::Mat& dst, int ksize) {
+    if (fixed_gaussian_supported(src, ksize)) {
+        fixed_gaussian_blur(src, dst, ksize);
+    } else {
+        cv::GaussianBlur(src, dst, cv::Size(ksize, ksize), 0);
+    }
+}
+
+const char* fixed_gaussian_isa() {
+    return row_kernels().name;
+}
+
+} // namespace droplet
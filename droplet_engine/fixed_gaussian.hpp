@@ -0,0 +1,22 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+namespace droplet {
+
+// 3x3 / 5x5、sigma = 0 的 GaussianBlur（CV_8UC1、BORDER_REFLECT_101），與 OpenCV 的 8 位元定點結果逐位元相同。
+// 係數 [1 2 1] / [1 4 6 4 1] 在編譯期決定；水平結果以 16 位元整數存入 ksize 列的環狀緩衝，
+// 垂直加權和以 (S + 2^(n-1)) >> n 四捨五入。依執行時的 CPU 選用 AVX-512BW / AVX2 / SSE4.1，
+// 其他平台走 CV_SIMD128。以列帶分段平行（依 ParallelStage::OpenCV）。
+// 輸入視為獨立影像（ROI 以外的像素不讀取）；dst 大小、型別相同時直接覆寫，可與 src 相同
+void fixed_gaussian_blur(const cv::Mat& src, cv::Mat& dst, int ksize);
+
+bool fixed_gaussian_supported(const cv::Mat& src, int ksize);
+
+// 支援時用 fixed_gaussian_blur，否則 cv::GaussianBlur(src, dst, Size(ksize, ksize), 0)
+void gaussian_blur(const cv::Mat& src, cv::Mat& dst, int ksize);
+
+// 目前選用的指令集名稱（"AVX-512BW"、"AVX2"、"SSE4.1"、"baseline"）
+const char* fixed_gaussian_isa();
+
+} // namespace droplet
@@ -0,0 +1,335 @@
+#include "droplet_engine/fused_segment.hpp"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace droplet {
+
+namespace {
+
+// 每個執行緒一份的列暫存，影像寬度不變時不再配置
+struct SegmentScratch {
+    std::vector<ushort> blur_ring;      // ksize 列模糊的水平結果
+    std::vector<short> difference_ring; // ksize 列差值的水平結果
+    std::vector<uchar> padded;          // 左右補邊的輸入列
+    std::vector<short> padded_difference;
+    std::vector<uchar> row;             // 轉成 runs 前的一列二值結果
+};
+
+thread_local SegmentScratch tls_segment;
+
+template<class T>
+T* ensure(std::vector<T>& buffer, size_t size) {
+    if (buffer.size() < size) {
+        buffer.resize(size);
+    }
+    return buffer.data();
+}
+
+// OpenCV 對 8 位元、sigma = 0 的 3x3 / 5x5 GaussianBlur 走定點運算：
+// 係數為 [1 2 1]/4 與 [1 4 6 4 1]/16，水平結果以整數保存，
+// 垂直加總後四捨五入，即 (S + 8) >> 4 與 (S + 128) >> 8（S 為整數權重的二維加權和）。
+// 5x5 的 S 最大為 255 * 256 = 65280，整個計算都能放在 16 位元內。
+
+void blur_row_horizontal(const uchar* src, int width, int ksize, uchar* padded, ushort* dst) {
+    int r = ksize / 2;
+    // BORDER_REFLECT_101 補邊
+    for (int i = 0; i < r; ++i) {
+        padded[i] = src[cv::borderInterpolate(i - r, width, cv::BORDER_REFLECT_101)];
+        padded[r + width + i] = src[cv::borderInterpolate(width + i, width, cv::BORDER_REFLECT_101)];
+    }
+    std::memcpy(padded + r, src, width);
+
+    int x = 0;
+    if (ksize == 3) {
+#if CV_SIMD128
+        for (; x <= width - 8; x += 8) {
+            cv::v_uint16x8 a = cv::v_load_expand(padded + x);
+            cv::v_uint16x8 b = cv::v_load_expand(padded + x + 1);
+            cv::v_uint16x8 c = cv::v_load_expand(padded + x + 2);
+            cv::v_store(dst + x, a + c + (b << 1));
+        }
+#endif
+        for (; x < width; ++x) {
+            const uchar* p = padded + x;
+            dst[x] = (ushort)(p[0] + p[2] + 2 * p[1]);
+        }
+    } else {
+#if CV_SIMD128
+        for (; x <= width - 8; x += 8) {
+            cv::v_uint16x8 a = cv::v_load_expand(padded + x);
+            cv::v_uint16x8 b = cv::v_load_expand(padded + x + 1);
+            cv::v_uint16x8 c = cv::v_load_expand(padded + x + 2);
+            cv::v_uint16x8 d = cv::v_load_expand(padded + x + 3);
+            cv::v_uint16x8 e = cv::v_load_expand(padded + x + 4);
+            cv::v_store(dst + x, a + e + ((b + d) << 2) + (c << 2) + (c << 1));
+        }
+#endif
+        for (; x < width; ++x) {
+            const uchar* p = padded + x;
+            dst[x] = (ushort)(p[0] + p[4] + 4 * (p[1] + p[3]) + 6 * p[2]);
+        }
+    }
+}
+
+#if CV_SIMD128
+inline cv::v_uint16x8 blur_vertical(const ushort* const* rows, int ksize, int x) {
+    if (ksize == 3) {
+        cv::v_uint16x8 s = cv::v_load(rows[0] + x) + cv::v_load(rows[2] + x) + (cv::v_load(rows[1] + x) << 1);
+        return (s + cv::v_setall_u16(8)) >> 4;
+    }
+    cv::v_uint16x8 c = cv::v_load(rows[2] + x);
+    cv::v_uint16x8 s = cv::v_load(rows[0] + x) + cv::v_load(rows[4] + x)
+                     + ((cv::v_load(rows[1] + x) + cv::v_load(rows[3] + x)) << 2)
+                     + (c << 2) + (c << 1);
+    return (s + cv::v_setall_u16(128)) >> 8;
+}
+#endif
+
+// 垂直模糊後直接與背景比較：max(bg - blurred, 0) > t  <=>  bg > blurred + t
+void blur_column_threshold(const ushort* const* rows, int ksize, const uchar* bg, int t, int width, uchar* dst) {
+    int x = 0;
+#if CV_SIMD128
+    cv::v_uint8x16 vt = cv::v_setall_u8((uchar)t);
+    for (; x <= width - 16; x += 16) {
+        cv::v_uint8x16 blurred = cv::v_pack(blur_vertical(rows, ksize, x), blur_vertical(rows, ksize, x + 8));
+        // 8 位元加法為飽和運算，blurred + t >= 255 時不可能成立
+        cv::v_store(dst + x, cv::v_load(bg + x) > (blurred + vt));
+    }
+#endif
+    for (; x < width; ++x) {
+        int blurred;
+        if (ksize == 3) {
+            blurred = (rows[0][x] + rows[2][x] + 2 * rows[1][x] + 8) >> 4;
+        } else {
+            blurred = (rows[0][x] + rows[4][x] + 4 * (rows[1][x] + rows[3][x]) + 6 * rows[2][x] + 128) >> 8;
+        }
+        dst[x] = bg[x] > blurred + t ? 255 : 0;
+    }
+}
+
+// ksize 列水平結果的環狀緩衝（ring 至少 ksize * width）；來源列 sy 放在 sy % ksize，視窗內的列不會互相覆蓋。
+// horizontal(sy, dst) 寫入第 sy 列的水平結果，每一列的 ksize 個結果備妥後呼叫 emit_row(y, rows)
+template<class T, class Horizontal, class RowSink>
+void ring_rows(int height, int width, int ksize, T* ring, Horizontal horizontal, RowSink emit_row) {
+    int r = ksize / 2;
+    int ring_row[5] = { -1, -1, -1, -1, -1 };
+    const T* rows[5];
+
+    for (int y = 0; y < height; ++y) {
+        for (int k = 0; k < ksize; ++k) {
+            int sy = cv::borderInterpolate(y - r + k, height, cv::BORDER_REFLECT_101);
+            int slot = sy % ksize;
+            T* slot_data = ring + (size_t)slot * width;
+            if (ring_row[slot] != sy) {
+                horizontal(sy, slot_data);
+                ring_row[slot] = sy;
+            }
+            rows[k] = slot_data;
+        }
+        emit_row(y, rows);
+    }
+}
+
+template<class RowSink>
+void blur_rows(const cv::Mat& image, int ksize, RowSink emit_row) {
+    SegmentScratch& scratch = tls_segment;
+    uchar* padded = ensure(scratch.padded, image.cols + 2 * (ksize / 2));
+    ushort* ring = ensure(scratch.blur_ring, (size_t)ksize * image.cols);
+    ring_rows<ushort>(image.rows, image.cols, ksize, ring, [&](int sy, ushort* dst) {
+        blur_row_horizontal(image.ptr<uchar>(sy), image.cols, ksize, padded, dst);
+    }, emit_row);
+}
+
+// 有號差值 bg - image 的水平加權和；權重和為 4 / 16，最大 ±255 * 16，int16 放得下
+void difference_row_horizontal(const uchar* image, const uchar* bg, int width, int ksize, short* padded, short* dst) {
+    int r = ksize / 2;
+    int x = 0;
+#if CV_SIMD128
+    for (; x <= width - 8; x += 8) {
+        cv::v_store(padded + r + x, cv::v_reinterpret_as_s16(cv::v_load_expand(bg + x)) -
+                                    cv::v_reinterpret_as_s16(cv::v_load_expand(image + x)));
+    }
+#endif
+    for (; x < width; ++x) {
+        padded[r + x] = (short)(bg[x] - image[x]);
+    }
+    // BORDER_REFLECT_101 補邊
+    for (int i = 0; i < r; ++i) {
+        padded[i] = padded[r + cv::borderInterpolate(i - r, width, cv::BORDER_REFLECT_101)];
+        padded[r + width + i] = padded[r + cv::borderInterpolate(width + i, width, cv::BORDER_REFLECT_101)];
+    }
+
+    x = 0;
+    if (ksize == 3) {
+#if CV_SIMD128
+        for (; x <= width - 8; x += 8) {
+            const short* p = padded + x;
+            cv::v_store(dst + x, cv::v_load(p) + cv::v_load(p + 2) + (cv::v_load(p + 1) << 1));
+        }
+#endif
+        for (; x < width; ++x) {
+            const short* p = padded + x;
+            dst[x] = (short)(p[0] + p[2] + 2 * p[1]);
+        }
+    } else {
+#if CV_SIMD128
+        for (; x <= width - 8; x += 8) {
+            const short* p = padded + x;
+            cv::v_int16x8 c = cv::v_load(p + 2);
+            cv::v_store(dst + x, cv::v_load(p) + cv::v_load(p + 4) + ((cv::v_load(p + 1) + cv::v_load(p + 3)) << 2) +
+                                 (c << 2) + (c << 1));
+        }
+#endif
+        for (; x < width; ++x) {
+            const short* p = padded + x;
+            dst[x] = (short)(p[0] + p[4] + 4 * (p[1] + p[3]) + 6 * p[2]);
+        }
+    }
+}
+
+// 四捨五入後的模糊差值 (S + 2^(n-1)) >> n > t  <=>  S >= ((t + 1) << n) - 2^(n-1)。
+// 5x5 的 S 最大為 ±255 * 256，垂直加總改用 int32
+void difference_column_threshold(const short* const* rows, int ksize, int t, int width, uchar* dst) {
+    int shift = ksize == 3 ? 4 : 8;
+    int limit = ((t + 1) << shift) - (1 << (shift - 1));
+    int x = 0;
+#if CV_SIMD128
+    cv::v_int32x4 vlimit = cv::v_setall_s32(limit - 1);
+    for (; x <= width - 16; x += 16) {
+        cv::v_int16x8 masks[2];
+        for (int half = 0; half < 2; ++half) {
+            int xh = x + half * 8;
+            cv::v_int32x4 lo[5], hi[5];
+            for (int k = 0; k < ksize; ++k) {
+                cv::v_expand(cv::v_load(rows[k] + xh), lo[k], hi[k]);
+            }
+            cv::v_int32x4 slo, shi;
+            if (ksize == 3) {
+                slo = lo[0] + lo[2] + (lo[1] << 1);
+                shi = hi[0] + hi[2] + (hi[1] << 1);
+            } else {
+                slo = lo[0] + lo[4] + ((lo[1] + lo[3]) << 2) + (lo[2] << 2) + (lo[2] << 1);
+                shi = hi[0] + hi[4] + ((hi[1] + hi[3]) << 2) + (hi[2] << 2) + (hi[2] << 1);
+            }
+            masks[half] = cv::v_pack(slo > vlimit, shi > vlimit);
+        }
+        // 比較結果為 0 / -1，飽和壓縮後仍是 0 / -1，即 0 / 255
+        cv::v_store(dst + x, cv::v_reinterpret_as_u8(cv::v_pack(masks[0], masks[1])));
+    }
+#endif
+    for (; x < width; ++x) {
+        int s;
+        if (ksize == 3) {
+            s = rows[0][x] + rows[2][x] + 2 * rows[1][x];
+        } else {
+            s = rows[0][x] + rows[4][x] + 4 * (rows[1][x] + rows[3][x]) + 6 * rows[2][x];
+        }
+        dst[x] = s >= limit ? 255 : 0;
+    }
+}
+
+template<class RowSink>
+void difference_rows(const cv::Mat& image, const cv::Mat& background, int ksize, RowSink emit_row) {
+    SegmentScratch& scratch = tls_segment;
+    short* padded = ensure(scratch.padded_difference, image.cols + 2 * (ksize / 2));
+    short* ring = ensure(scratch.difference_ring, (size_t)ksize * image.cols);
+    ring_rows<short>(image.rows, image.cols, ksize, ring, [&](int sy, short* dst) {
+        difference_row_horizontal(image.ptr<uchar>(sy), background.ptr<uchar>(sy), image.cols, ksize, padded, dst);
+    }, emit_row);
+}
+
+} // namespace
+
+bool fused_segment_supported(const cv::Mat& image, int ksize) {
+    return image.type() == CV_8UC1 && (ksize == 3 || ksize == 5);
+}
+
+void fused_segment(const cv::Mat& image, const cv::Mat& blurred_bg, cv::Mat& binary, int ksize, double thresh) {
+    CV_Assert(fused_segment_supported(image, ksize));
+    CV_Assert(blurred_bg.type() == CV_8UC1 && blurred_bg.size() == image.size());
+    CV_Assert(binary.data != image.data);
+
+    binary.create(image.size(), CV_8UC1);
+    if (thresh < 0) {
+        binary.setTo(255);
+        return;
+    }
+    if (thresh >= 255) {
+        binary.setTo(0);
+        return;
+    }
+    int t = cvFloor(thresh);
+
+    blur_rows(image, ksize, [&](int y, const ushort* const* rows) {
+        blur_column_threshold(rows, ksize, blurred_bg.ptr<uchar>(y), t, image.cols, binary.ptr<uchar>(y));
+    });
+}
+
+void fused_segment(const cv::Mat& image, const cv::Mat& blurred_bg, RunLengthMask& runs, int ksize, double thresh) {
+    CV_Assert(fused_segment_supported(image, ksize));
+    CV_Assert(blurred_bg.type() == CV_8UC1 && blurred_bg.size() == image.size());
+
+    runs.reset(image.rows, image.cols);
+    uchar* row = ensure(tls_segment.row, image.cols);
+    if (thresh < 0 || thresh >= 255) {
+        std::fill(row, row + image.cols, thresh < 0 ? 255 : 0);
+        for (int y = 0; y < image.rows; ++y) {
+            runs.append_row(row);
+        }
+        return;
+    }
+    int t = cvFloor(thresh);
+
+    // 每列二值結果只存在一列的暫存中，立即轉成 runs
+    blur_rows(image, ksize, [&](int y, const ushort* const* rows) {
+        blur_column_threshold(rows, ksize, blurred_bg.ptr<uchar>(y), t, image.cols, row);
+        runs.append_row(row);
+    });
+}
+
+void difference_segment(const cv::Mat& image, const cv::Mat& background, cv::Mat& binary, int ksize, double thresh) {
+    CV_Assert(fused_segment_supported(image, ksize));
+    CV_Assert(background.type() == CV_8UC1 && background.size() == image.size());
+    CV_Assert(binary.data != image.data && binary.data != background.data);
+
+    binary.create(image.size(), CV_8UC1);
+    if (thresh < 0) {
+        binary.setTo(255);
+        return;
+    }
+    if (thresh >= 255) {
+        binary.setTo(0);
+        return;
+    }
+    int t = cvFloor(thresh);
+
+    difference_rows(image, background, ksize, [&](int y, const short* const* rows) {
+        difference_column_threshold(rows, ksize, t, image.cols, binary.ptr<uchar>(y));
+    });
+}
+
+void difference_segment(const cv::Mat& image, const cv::Mat& background, RunLengthMask& runs, int ksize, double thresh) {
+    CV_Assert(fused_segment_supported(image, ksize));
+    CV_Assert(background.type() == CV_8UC1 && background.size() == image.size());
+
+    runs.reset(image.rows, image.cols);
+    uchar* row = ensure(tls_segment.row, image.cols);
+    if (thresh < 0 || thresh >= 255) {
+        std::fill(row, row + image.cols, thresh < 0 ? 255 : 0);
+        for (int y = 0; y < image.rows; ++y) {
+            runs.append_row(row);
+        }
+        return;
+    }
+    int t = cvFloor(thresh);
+
+    difference_rows(image, background, ksize, [&](int y, const short* const* rows) {
+        difference_column_threshold(rows, ksize, t, image.cols, row);
+        runs.append_row(row);
+    });
+}
+
+} // namespace droplet
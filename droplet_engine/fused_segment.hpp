@@ -0,0 +1,29 @@
+#pragma once
+
+#include "droplet_engine/run_length.hpp"
+
+#include <opencv2/opencv.hpp>
+
+namespace droplet {
+
+// 單次逐列掃描完成
+//     GaussianBlur(image, blurred, Size(ksize, ksize), 0)
+//     subtract(blurred_bg, blurred, bg_sub)
+//     threshold(bg_sub, binary, thresh, 255, THRESH_BINARY)
+// 不產生中間 Mat。只支援 CV_8UC1 與 ksize = 3 / 5，結果與 OpenCV 三個步驟逐位元相同。
+void fused_segment(const cv::Mat& image, const cv::Mat& blurred_bg, cv::Mat& binary, int ksize, double thresh);
+
+// 同上，但直接輸出 run-length，不產生整張二值 Mat
+void fused_segment(const cv::Mat& image, const cv::Mat& blurred_bg, RunLengthMask& runs, int ksize, double thresh);
+
+bool fused_segment_supported(const cv::Mat& image, int ksize);
+
+// 背景不需要事先模糊：模糊是線性的，先算有號差值 background - image（int16）再模糊一次，
+// 四捨五入後 > thresh 的像素為 255，每張影像只做一次模糊。
+// 捨入前的值與 blur(background) - blur(image) 完全相同；但原流程是兩邊各自四捨五入後才相減，
+// 這裡只捨入一次，模糊後的差值距離門檻不到 1 個灰階的像素可能不同（差值最多相差 1，segment_test 檢查）。
+// 支援的格式與 fused_segment 相同
+void difference_segment(const cv::Mat& image, const cv::Mat& background, cv::Mat& binary, int ksize, double thresh);
+void difference_segment(const cv::Mat& image, const cv::Mat& background, RunLengthMask& runs, int ksize, double thresh);
+
+} // namespace droplet
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+
+namespace droplet {
+
+// 腐蝕取最小值、膨脹取最大值；影像外的像素以單位元素（255 / 0）代替，
+// 等同 OpenCV 的 morphologyDefaultBorderValue()
+struct MinOp {
+    static constexpr uchar identity = 255;
+    static uchar apply(uchar a, uchar b) { return std::min(a, b); }
+#if CV_SIMD128
+    static cv::v_uint8x16 apply(const cv::v_uint8x16& a, const cv::v_uint8x16& b) { return cv::v_min(a, b); }
+#endif
+};
+
+struct MaxOp {
+    static constexpr uchar identity = 0;
+    static uchar apply(uchar a, uchar b) { return std::max(a, b); }
+#if CV_SIMD128
+    static cv::v_uint8x16 apply(const cv::v_uint8x16& a, const cv::v_uint8x16& b) { return cv::v_max(a, b); }
+#endif
+};
+
+// dst[x] = op(a[x], b[x])；dst 可與 a 或 b 相同
+template<class Op>
+inline void combine_rows(uchar* dst, const uchar* a, const uchar* b, int width) {
+    int x = 0;
+#if CV_SIMD128
+    for (; x <= width - 16; x += 16) {
+        cv::v_store(dst + x, Op::apply(cv::v_load(a + x), cv::v_load(b + x)));
+    }
+#endif
+    for (; x < width; ++x) {
+        dst[x] = Op::apply(a[x], b[x]);
+    }
+}
+
+// dst[x] = op(dst[x], src[x])
+template<class Op>
+inline void combine_row(uchar* dst, const uchar* src, int width) {
+    combine_rows<Op>(dst, dst, src, width);
+}
+
+} // namespace droplet
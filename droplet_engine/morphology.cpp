@@ -0,0 +1,316 @@
+#include "droplet_engine/morphology.hpp"
+#include "droplet_engine/morph_ops.hpp"
+#include "droplet_engine/threading_policy.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+namespace droplet {
+
+namespace {
+
+// 各列帶獨立從頭做 van Herk，帶與帶之間可以平行
+const int kBandRows = 64;
+// 水平視窗不超過這個寬度時用倍增（log2(w) 次整列 SIMD 運算），比逐像素的 van Herk 快
+const int kDoublingMaxWindow = 64;
+
+// 結構元素拆解後的形式；anchor 固定在中心（與 cv::erode 的預設相同）
+struct KernelLayout {
+    enum Kind { Rect, Cross, Segments };
+    // 核第 row 列從第 col 行開始連續 length 個非零
+    struct Segment {
+        int row, col, length;
+    };
+
+    Kind kind = Rect;
+    cv::Size size;
+    cv::Point anchor;
+    std::vector<Segment> segments;
+    int max_length = 1;
+};
+
+KernelLayout rect_layout(cv::Size size) {
+    KernelLayout layout;
+    layout.size = size;
+    layout.anchor = cv::Point(size.width / 2, size.height / 2);
+    return layout;
+}
+
+// 每個執行緒一份；segments 的容量重複使用，每次腐蝕 / 膨脹不再配置
+thread_local KernelLayout tls_layout;
+
+// 結果放在 tls_layout 中，下一次呼叫前有效
+const KernelLayout& analyze_kernel(const cv::Mat& kernel) {
+    KernelLayout& layout = tls_layout;
+    layout.kind = KernelLayout::Rect;
+    layout.segments.clear();
+    layout.max_length = 1;
+    if (kernel.empty()) {
+        // cv::erode 對空的核使用 3x3 矩形
+        layout.size = cv::Size(3, 3);
+        layout.anchor = cv::Point(1, 1);
+        return layout;
+    }
+    CV_Assert(kernel.type() == CV_8UC1);
+
+    layout.size = kernel.size();
+    layout.anchor = cv::Point(kernel.cols / 2, kernel.rows / 2);
+    bool rect = true, cross = true;
+    for (int r = 0; r < kernel.rows; ++r) {
+        const uchar* row = kernel.ptr<uchar>(r);
+        for (int c = 0; c < kernel.cols; ++c) {
+            bool on = row[c] != 0;
+            rect = rect && on;
+            cross = cross && on == (r == layout.anchor.y || c == layout.anchor.x);
+        }
+        for (int c = 0; c < kernel.cols;) {
+            if (!row[c]) {
+                ++c;
+                continue;
+            }
+            int start = c;
+            while (c < kernel.cols && row[c]) {
+                ++c;
+            }
+            layout.segments.push_back({ r, start, c - start });
+            layout.max_length = std::max(layout.max_length, c - start);
+        }
+    }
+    CV_Assert(!layout.segments.empty());
+    layout.kind = rect ? KernelLayout::Rect : cross ? KernelLayout::Cross : KernelLayout::Segments;
+    return layout;
+}
+
+// 每個執行緒一份，只會變大；穩態下不再配置
+struct MorphScratch {
+    std::vector<uchar> identity;    // 影像外的列
+    std::vector<uchar> head, tail;  // 垂直 van Herk 區塊內的後綴 / 前綴
+    std::vector<uchar> padded;      // 水平視窗的輸入，左右補單位元素
+    std::vector<uchar> prefix, suffix;
+    std::vector<uchar> levels;      // Segments：各來源列的倍增層
+    std::vector<int> level_row;
+};
+
+thread_local MorphScratch tls_scratch;
+
+template<class T>
+T* ensure(std::vector<T>& buffer, size_t size) {
+    if (buffer.size() < size) {
+        buffer.resize(size);
+    }
+    return buffer.data();
+}
+
+// dst = op(a, b)；b 為 nullptr 時 dst = a
+template<class Op>
+void merge_rows(uchar* dst, const uchar* a, const uchar* b, int width) {
+    if (b) {
+        combine_rows<Op>(dst, a, b, width);
+    } else {
+        std::copy(a, a + width, dst);
+    }
+}
+
+// dst[x] = op(padded[x .. x + window - 1])，x 為 [0, width)；padded 長 width + window - 1，會被覆寫
+template<class Op>
+void horizontal_window(uchar* padded, uchar* dst, int width, int window, MorphScratch& scratch) {
+    int len = width + window - 1;
+    if (window <= kDoublingMaxWindow) {
+        // 第 k 輪後 padded[q] = op(原 padded[q .. q + 2^k - 1])；由左往右就地更新不會讀到已寫入的值
+        int span = 1;
+        while (span * 2 <= window) {
+            len -= span;
+            combine_rows<Op>(padded, padded, padded + span, len);
+            span *= 2;
+        }
+        combine_rows<Op>(dst, padded, padded + (window - span), width);
+        return;
+    }
+
+    // van Herk / Gil-Werman：以 window 為區塊，區塊內的前綴 g 與後綴 h，
+    // 任一視窗恰好跨兩個區塊：op(h[x], g[x + window - 1])
+    uchar* g = ensure(scratch.prefix, len);
+    uchar* h = ensure(scratch.suffix, len);
+    for (int start = 0; start < len; start += window) {
+        int end = std::min(start + window, len);
+        g[start] = padded[start];
+        for (int q = start + 1; q < end; ++q) {
+            g[q] = Op::apply(g[q - 1], padded[q]);
+        }
+        h[end - 1] = padded[end - 1];
+        for (int q = end - 2; q >= start; --q) {
+            h[q] = Op::apply(h[q + 1], padded[q]);
+        }
+    }
+    for (int x = 0; x < width; ++x) {
+        dst[x] = Op::apply(h[x], g[x + window - 1]);
+    }
+}
+
+// 垂直 van Herk：對 [y0, y1) 的每一列呼叫 emit(y, a, b)，op(a, b) 為 src 第 y - anchor .. y - anchor + height - 1
+// 列的逐行 op（b 可能為 nullptr）。影像外的列為單位元素。每列輸出固定兩次整列運算，與 height 無關
+template<class Op, class Emit>
+void vertical_window(const cv::Mat& src, int height, int anchor, int y0, int y1, MorphScratch& scratch, Emit emit) {
+    int width = src.cols;
+    const uchar* identity = scratch.identity.data();
+    auto row = [&](int y) {
+        int sy = y - anchor;
+        return sy < 0 || sy >= src.rows ? identity : src.ptr<uchar>(sy);
+    };
+    // head[i] = op(列 base + i .. base + height - 1)，tail[i] = op(列 base + height .. base + height + i)
+    uchar* head = ensure(scratch.head, (size_t)height * width);
+    uchar* tail = ensure(scratch.tail, (size_t)height * width);
+
+    for (int base = y0; base < y1; base += height) {
+        int count = std::min(height, y1 - base);
+        uchar* last = head + (size_t)(height - 1) * width;
+        std::copy(row(base + height - 1), row(base + height - 1) + width, last);
+        for (int i = height - 2; i >= 0; --i) {
+            combine_rows<Op>(head + (size_t)i * width, row(base + i), head + (size_t)(i + 1) * width, width);
+        }
+        for (int i = 0; i + 1 < count; ++i) {
+            uchar* t = tail + (size_t)i * width;
+            merge_rows<Op>(t, row(base + height + i), i == 0 ? nullptr : t - width, width);
+        }
+        for (int i = 0; i < count; ++i) {
+            emit(base + i, head + (size_t)i * width, i == 0 ? nullptr : tail + (size_t)(i - 1) * width);
+        }
+    }
+}
+
+// src 一列補邊後放進 padded（左 anchor 個、右 window - 1 - anchor 個單位元素）
+template<class Op>
+uchar* pad_row(uchar* padded, int width, int window, int anchor) {
+    std::fill(padded, padded + anchor, Op::identity);
+    std::fill(padded + anchor + width, padded + width + window - 1, Op::identity);
+    return padded + anchor;
+}
+
+template<class Op>
+void rect_band(const cv::Mat& src, cv::Mat& dst, const KernelLayout& layout, int y0, int y1, MorphScratch& scratch) {
+    int width = src.cols;
+    uchar* padded = ensure(scratch.padded, width + layout.size.width - 1);
+    vertical_window<Op>(src, layout.size.height, layout.anchor.y, y0, y1, scratch,
+                        [&](int y, const uchar* a, const uchar* b) {
+        merge_rows<Op>(pad_row<Op>(padded, width, layout.size.width, layout.anchor.x), a, b, width);
+        horizontal_window<Op>(padded, dst.ptr<uchar>(y), width, layout.size.width, scratch);
+    });
+}
+
+// 十字 = 第 y 列的水平視窗與第 x 行的垂直視窗
+template<class Op>
+void cross_band(const cv::Mat& src, cv::Mat& dst, const KernelLayout& layout, int y0, int y1, MorphScratch& scratch) {
+    int width = src.cols;
+    uchar* padded = ensure(scratch.padded, width + layout.size.width - 1);
+    vertical_window<Op>(src, layout.size.height, layout.anchor.y, y0, y1, scratch,
+                        [&](int y, const uchar* a, const uchar* b) {
+        uchar* out = dst.ptr<uchar>(y);
+        const uchar* s = src.ptr<uchar>(y);
+        std::copy(s, s + width, pad_row<Op>(padded, width, layout.size.width, layout.anchor.x));
+        horizontal_window<Op>(padded, out, width, layout.size.width, scratch);
+        combine_row<Op>(out, a, width);
+        if (b) {
+            combine_row<Op>(out, b, width);
+        }
+    });
+}
+
+// 一般形狀：每個來源列算一次倍增層 L_k[q] = op(padded[q .. q + 2^k - 1])，放在 height 列的環狀緩衝中；
+// 長度為 n 的線段由兩個重疊的 L_k 合併（2^k <= n < 2^(k+1)）
+template<class Op>
+void segment_band(const cv::Mat& src, cv::Mat& dst, const KernelLayout& layout, int y0, int y1, MorphScratch& scratch) {
+    int width = src.cols;
+    int len = width + layout.size.width - 1;
+    int levels = 1;
+    while ((1 << levels) <= layout.max_length) {
+        ++levels;
+    }
+    size_t slot_size = (size_t)levels * len;
+    int slots = layout.size.height;
+    uchar* ring = ensure(scratch.levels, slots * slot_size);
+    int* ring_row = ensure(scratch.level_row, slots);
+    std::fill(ring_row, ring_row + slots, INT_MIN);
+
+    for (int y = y0; y < y1; ++y) {
+        uchar* out = dst.ptr<uchar>(y);
+        std::fill(out, out + width, Op::identity);
+        for (const KernelLayout::Segment& segment : layout.segments) {
+            int sy = y + segment.row - layout.anchor.y;
+            if (sy < 0 || sy >= src.rows) {
+                continue;
+            }
+            uchar* level = ring + (sy % slots) * slot_size;
+            if (ring_row[sy % slots] != sy) {
+                const uchar* s = src.ptr<uchar>(sy);
+                std::copy(s, s + width, pad_row<Op>(level, width, layout.size.width, layout.anchor.x));
+                for (int k = 1; k < levels; ++k) {
+                    uchar* prev = level + (size_t)(k - 1) * len;
+                    combine_rows<Op>(prev + len, prev, prev + (1 << (k - 1)), len - (1 << k) + 1);
+                }
+                ring_row[sy % slots] = sy;
+            }
+            int k = 0;
+            while ((2 << k) <= segment.length) {
+                ++k;
+            }
+            const uchar* window = level + (size_t)k * len + segment.col;
+            combine_row<Op>(out, window, width);
+            if (segment.length != (1 << k)) {
+                combine_row<Op>(out, window + segment.length - (1 << k), width);
+            }
+        }
+    }
+}
+
+template<class Op>
+void run_morph(const cv::Mat& input, cv::Mat& dst, const KernelLayout& layout) {
+    CV_Assert(input.type() == CV_8UC1);
+    // 先複製標頭：dst 可能就是 input 本身，重設 dst 後仍保有原資料
+    cv::Mat src = input;
+    if (dst.data == src.data) {
+        dst = cv::Mat();
+    }
+    dst.create(src.size(), CV_8UC1);
+    if (src.empty()) {
+        return;
+    }
+
+    int bands = (src.rows + kBandRows - 1) / kBandRows;
+    #pragma omp parallel for schedule(dynamic) if(parallel_within_frame(ParallelStage::Morphology, src.rows * src.cols))
+    for (int b = 0; b < bands; ++b) {
+        int y0 = b * kBandRows;
+        int y1 = std::min(src.rows, y0 + kBandRows);
+        MorphScratch& scratch = tls_scratch;
+        uchar* identity = ensure(scratch.identity, src.cols);
+        std::fill(identity, identity + src.cols, Op::identity);
+        if (layout.kind == KernelLayout::Rect) {
+            rect_band<Op>(src, dst, layout, y0, y1, scratch);
+        } else if (layout.kind == KernelLayout::Cross) {
+            cross_band<Op>(src, dst, layout, y0, y1, scratch);
+        } else {
+            segment_band<Op>(src, dst, layout, y0, y1, scratch);
+        }
+    }
+}
+
+} // namespace
+
+void parallel_erode(const cv::Mat& src, cv::Mat& dst, const cv::Mat& kernel) {
+    run_morph<MinOp>(src, dst, analyze_kernel(kernel));
+}
+
+void parallel_dilate(const cv::Mat& src, cv::Mat& dst, const cv::Mat& kernel) {
+    run_morph<MaxOp>(src, dst, analyze_kernel(kernel));
+}
+
+void morph_rect(const cv::Mat& src, cv::Mat& dst, MorphOp op, cv::Size size) {
+    CV_Assert(size.width > 0 && size.height > 0);
+    if (op == MorphOp::Erode) {
+        run_morph<MinOp>(src, dst, rect_layout(size));
+    } else {
+        run_morph<MaxOp>(src, dst, rect_layout(size));
+    }
+}
+
+} // namespace droplet
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+namespace droplet {
+
+enum class MorphOp { Erode, Dilate };
+
+struct MorphStep {
+    MorphOp op;
+    int iterations;
+};
+
+// 呼叫 cv::erode / cv::dilate 時的邊界：ROI 視為獨立影像（不讀父影像在 ROI 外的像素），
+// 影像外為 cv::morphologyDefaultBorderValue()。PipelineWorkspace 的緩衝是較大 Mat 的 ROI，不可省略
+const int kIsolatedBorder = cv::BORDER_CONSTANT | cv::BORDER_ISOLATED;
+
+// 單次腐蝕 / 膨脹（CV_8UC1），與 cv::erode / cv::dilate（anchor 在中心、預設邊界值）逐位元相同。
+// MORPH_RECT 垂直、水平各做一次 van Herk / Gil-Werman，每像素的成本與核大小無關；
+// MORPH_CROSS 分別算垂直與水平視窗再合併；其他形狀（橢圓等）拆成各列的水平線段。
+// 以列帶分段平行（依 ParallelStage::Morphology）。
+// dst 大小、型別相同時直接覆寫，不重新配置；dst 與 src 共用資料時改寫到新的緩衝
+void parallel_erode(const cv::Mat& src, cv::Mat& dst, const cv::Mat& kernel);
+void parallel_dilate(const cv::Mat& src, cv::Mat& dst, const cv::Mat& kernel);
+
+// size.width x size.height 矩形核（anchor 在中心）的單次腐蝕 / 膨脹
+void morph_rect(const cv::Mat& src, cv::Mat& dst, MorphOp op, cv::Size size);
+
+} // namespace droplet
@@ -0,0 +1,211 @@
+#include "droplet_engine/morphology_plan.hpp"
+#include "droplet_engine/morph_ops.hpp"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace droplet {
+
+namespace {
+
+// diamond_pass 的環狀緩衝，每個執行緒一份；影像寬度與半徑不變時不再配置
+struct DiamondScratch {
+    std::vector<uchar> ring;
+    std::vector<int> ring_row;
+};
+
+thread_local DiamondScratch tls_diamond;
+
+// dst[x] = op(src[x - 1], src[x], src[x + 1])，x 為 [1, len - 1) 的索引
+template<class Op>
+void spread_row(const uchar* src, uchar* dst, int len) {
+    int x = 1;
+#if CV_SIMD128
+    for (; x <= len - 17; x += 16) {
+        cv::v_uint8x16 v = Op::apply(cv::v_load(src + x - 1), cv::v_load(src + x));
+        cv::v_store(dst + x, Op::apply(v, cv::v_load(src + x + 1)));
+    }
+#endif
+    for (; x < len - 1; ++x) {
+        dst[x] = Op::apply(Op::apply(src[x - 1], src[x]), src[x + 1]);
+    }
+}
+
+// 菱形 = 各列上寬度遞減的水平線段之聯集：
+//     out(y, x) = op_{|dy| <= n} H_{n-|dy|}(y + dy, x)
+// 每個來源列只算一次各半徑的水平結果 H_0..H_n，放在 2n+1 列的環狀緩衝中
+// 每列要展開 n 層、合併 2n+1 列，每像素的成本是 O(n)，不是與半徑無關；省下的是 n 次逐次迭代的全圖讀寫
+template<class Op>
+void diamond_pass(const cv::Mat& src, cv::Mat& dst, int radius) {
+    int width = src.cols;
+    int height = src.rows;
+    int window = 2 * radius + 1;
+    int len = width + 2 * radius;
+    size_t slot_size = (size_t)(radius + 1) * len;
+
+    DiamondScratch& scratch = tls_diamond;
+    if (scratch.ring.size() < window * slot_size) {
+        scratch.ring.resize(window * slot_size);
+    }
+    scratch.ring_row.assign(window, -1);
+    uchar* ring = scratch.ring.data();
+    int* ring_row = scratch.ring_row.data();
+
+    for (int y = 0; y < height; ++y) {
+        uchar* out = dst.ptr<uchar>(y);
+        bool first = true;
+        for (int sy = std::max(0, y - radius); sy <= std::min(height - 1, y + radius); ++sy) {
+            int slot = sy % window;
+            uchar* levels = ring + slot * slot_size;
+            if (ring_row[slot] != sy) {
+                // H_0 為補邊後的原始列，H_r 由 H_{r-1} 左右各擴一格；H_r 在 [r, len - r) 內正確。
+                // 緩衝重複使用，每次重填 H_0 的左右補邊（其他層補邊外的值不影響正確範圍）
+                std::fill(levels, levels + radius, Op::identity);
+                std::fill(levels + radius + width, levels + len, Op::identity);
+                std::copy(src.ptr<uchar>(sy), src.ptr<uchar>(sy) + width, levels + radius);
+                for (int r = 1; r <= radius; ++r) {
+                    spread_row<Op>(levels + (size_t)(r - 1) * len, levels + (size_t)r * len, len);
+                }
+                ring_row[slot] = sy;
+            }
+            const uchar* h = levels + (size_t)(radius - std::abs(sy - y)) * len + radius;
+            if (first) {
+                std::copy(h, h + width, out);
+                first = false;
+            } else {
+                combine_row<Op>(out, h, width);
+            }
+        }
+    }
+}
+
+void append_step(std::vector<MorphStep>& merged, const MorphStep& step) {
+    if (step.iterations <= 0) {
+        return;
+    }
+    if (!merged.empty() && merged.back().op == step.op) {
+        merged.back().iterations += step.iterations;
+    } else {
+        merged.push_back(step);
+    }
+}
+
+void run_opencv_steps(const std::vector<MorphStep>& steps, const cv::Mat& kernel, const cv::Mat& src, cv::Mat& dst) {
+    cv::Mat cur = src;
+    for (const MorphStep& step : steps) {
+        cv::Mat next;
+        if (step.op == MorphOp::Erode) {
+            cv::erode(cur, next, kernel, cv::Point(-1, -1), step.iterations, kIsolatedBorder,
+                      cv::morphologyDefaultBorderValue());
+        } else {
+            cv::dilate(cur, next, kernel, cv::Point(-1, -1), step.iterations, kIsolatedBorder,
+                       cv::morphologyDefaultBorderValue());
+        }
+        cur = next;
+    }
+    dst = cur;
+}
+
+} // namespace
+
+void morph_square(const cv::Mat& src, cv::Mat& dst, MorphOp op, int radius) {
+    CV_Assert(src.type() == CV_8UC1 && radius >= 0);
+    CV_Assert(dst.data != src.data || dst.empty());
+    morph_rect(src, dst, op, cv::Size(2 * radius + 1, 2 * radius + 1));
+}
+
+void morph_diamond(const cv::Mat& src, cv::Mat& dst, MorphOp op, int radius) {
+    CV_Assert(src.type() == CV_8UC1 && radius >= 0);
+    CV_Assert(dst.data != src.data || dst.empty());
+    dst.create(src.size(), CV_8UC1);
+    if (op == MorphOp::Erode) {
+        diamond_pass<MinOp>(src, dst, radius);
+    } else {
+        diamond_pass<MaxOp>(src, dst, radius);
+    }
+}
+
+MorphPlan plan_morphology(const std::vector<MorphStep>& steps, int kernel_shape, int kernel_size) {
+    MorphPlan plan;
+    plan.kernel = cv::getStructuringElement(kernel_shape, cv::Size(kernel_size, kernel_size));
+
+    // erode 2 + erode 1 與 erode 3 完全相同
+    std::vector<MorphStep> merged;
+    for (const MorphStep& step : steps) {
+        append_step(merged, step);
+    }
+
+    bool odd = kernel_size % 2 == 1;
+    for (const MorphStep& step : merged) {
+        plan.original_passes += step.iterations;
+        PlannedPass pass = { step.op, PassShape::Kernel, 0, step.iterations };
+        if (kernel_size == 1) {
+            continue;
+        }
+        if (kernel_shape == cv::MORPH_RECT && odd) {
+            pass.shape = PassShape::Square;
+            pass.radius = step.iterations * (kernel_size / 2);
+        } else if (kernel_shape == cv::MORPH_CROSS && kernel_size == 3) {
+            pass.shape = PassShape::Diamond;
+            pass.radius = step.iterations;
+        }
+        plan.passes.push_back(pass);
+    }
+    return plan;
+}
+
+void run_morphology_plan(const MorphPlan& plan, const cv::Mat& src, cv::Mat& dst) {
+    cv::Mat ping, pong;
+    run_morphology_plan(plan, src, dst, ping, pong);
+}
+
+void run_morphology_plan(const MorphPlan& plan, const cv::Mat& src, cv::Mat& dst, cv::Mat& ping, cv::Mat& pong) {
+    if (plan.passes.empty()) {
+        src.copyTo(ping);
+        dst = ping;
+        return;
+    }
+
+    cv::Mat cur = src;
+    cv::Mat* next = &ping;
+    for (const PlannedPass& pass : plan.passes) {
+        if (pass.shape == PassShape::Square && cur.type() == CV_8UC1) {
+            morph_square(cur, *next, pass.op, pass.radius);
+        } else if (pass.shape == PassShape::Diamond && cur.type() == CV_8UC1) {
+            morph_diamond(cur, *next, pass.op, pass.radius);
+        } else if (pass.op == MorphOp::Erode) {
+            cv::erode(cur, *next, plan.kernel, cv::Point(-1, -1), pass.iterations, kIsolatedBorder,
+                      cv::morphologyDefaultBorderValue());
+        } else {
+            cv::dilate(cur, *next, plan.kernel, cv::Point(-1, -1), pass.iterations, kIsolatedBorder,
+                       cv::morphologyDefaultBorderValue());
+        }
+        cur = *next;
+        next = next == &ping ? &pong : &ping;
+    }
+    dst = cur;
+}
+
+bool verify_morphology_plan(const std::vector<MorphStep>& steps, int kernel_shape, int kernel_size, const cv::Mat& src) {
+    // 規劃結果把輸入當成獨立影像，比對時也先複製一份
+    cv::Mat isolated = src.clone();
+    MorphPlan plan = plan_morphology(steps, kernel_shape, kernel_size);
+
+    cv::Mat planned, expected;
+    run_morphology_plan(plan, isolated, planned);
+    run_opencv_steps(steps, plan.kernel, isolated, expected);
+
+    if (planned.size() != expected.size() || planned.type() != expected.type()) {
+        return false;
+    }
+    for (int y = 0; y < planned.rows; ++y) {
+        if (!std::equal(planned.ptr<uchar>(y), planned.ptr<uchar>(y) + planned.cols * planned.elemSize(),
+                        expected.ptr<uchar>(y))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace droplet
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "droplet_engine/morphology.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace droplet {
+
+// 規劃後的單次全圖掃描
+enum class PassShape {
+    Square,     // MORPH_RECT k x k 迭代 n 次 = 邊長 n*(k-1)+1 的正方形
+    Diamond,    // 3x3 MORPH_CROSS 迭代 n 次 = 半徑 n 的菱形（L1 球）
+    Kernel      // 無法化簡的形狀，交給 cv::erode / cv::dilate
+};
+
+struct PlannedPass {
+    MorphOp op;
+    PassShape shape;
+    int radius;         // Square / Diamond
+    int iterations;     // Kernel
+};
+
+struct MorphPlan {
+    std::vector<PlannedPass> passes;
+    cv::Mat kernel;             // Kernel pass 使用的結構元素
+    int original_passes = 0;    // 原本逐次迭代需要的全圖掃描次數
+};
+
+// 合併相鄰的同類步驟，並把可化簡的迭代轉成單次掃描
+MorphPlan plan_morphology(const std::vector<MorphStep>& steps, int kernel_shape, int kernel_size);
+
+// 與 cv::erode / cv::dilate（預設邊界值）逐位元相同；輸入視為獨立影像（不讀取 ROI 以外的像素）
+void run_morphology_plan(const MorphPlan& plan, const cv::Mat& src, cv::Mat& dst);
+// 同上，各次掃描輪流寫入 ping / pong（與 src 同大小、不與 src 重疊，可為 ROI），dst 指向最後結果；
+// 緩衝已配置時不產生新的 Mat
+void run_morphology_plan(const MorphPlan& plan, const cv::Mat& src, cv::Mat& dst, cv::Mat& ping, cv::Mat& pong);
+
+// 單次掃描的正方形 / 菱形腐蝕、膨脹（CV_8UC1）。正方形每像素的成本與半徑無關（van Herk / Gil-Werman），
+// 菱形每像素 O(radius)
+void morph_square(const cv::Mat& src, cv::Mat& dst, MorphOp op, int radius);
+void morph_diamond(const cv::Mat& src, cv::Mat& dst, MorphOp op, int radius);
+
+// 以逐次迭代的 OpenCV 呼叫驗證規劃結果是否逐位元相同
+bool verify_morphology_plan(const std::vector<MorphStep>& steps, int kernel_shape, int kernel_size, const cv::Mat& src);
+
+} // namespace droplet
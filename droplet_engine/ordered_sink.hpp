@@ -0,0 +1,74 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace droplet {
+
+// 平行階段的結果依影像順序輸出：第 next 張一到就立刻交給 emit，不等整批完成。
+// 重排緩衝只保留 window 張；比 next 超前 window 張以上的 submit 會等待（背壓）。
+// window 必須大於同時在處理中的影像數，否則負責 next 的執行緒也可能被擋住。
+// submit 的呼叫端不是處理影像的執行緒時（例如唯一的收集端），背壓要放在上游：
+// 送出第 index 張之前呼叫 wait_for_slot(index)，在途的影像就不會超出視窗，submit 永遠不會等待。
+// emit 一次只在一個執行緒中執行，且在鎖外呼叫，不會擋住其他 submit。
+template <typename T>
+class OrderedSink {
+public:
+    using Emit = std::function<void(size_t, T&)>;
+
+    OrderedSink(size_t window, Emit emit) : slots_(window < 1 ? 1 : window), emit_(std::move(emit)) {}
+
+    void submit(size_t index, T value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        space_.wait(lock, [&]() { return index < next_ + slots_.size(); });
+        slots_[index % slots_.size()] = std::move(value);
+        if (emitting_) {
+            // 目前的輸出者會在放開鎖後重新檢查
+            return;
+        }
+
+        emitting_ = true;
+        for (;;) {
+            std::optional<T>& slot = slots_[next_ % slots_.size()];
+            if (!slot) {
+                break;
+            }
+            T ready = std::move(*slot);
+            slot.reset();
+            size_t ready_index = next_++;
+            space_.notify_all();
+
+            lock.unlock();
+            emit_(ready_index, ready);
+            lock.lock();
+        }
+        emitting_ = false;
+    }
+
+    // 等到第 index 張有重排位置（index < next + window）
+    void wait_for_slot(size_t index) const {
+        std::unique_lock<std::mutex> lock(mutex_);
+        space_.wait(lock, [&]() { return index < next_ + slots_.size(); });
+    }
+
+    // 已輸出的張數（也是下一張要輸出的索引）
+    size_t emitted() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return next_;
+    }
+
+private:
+    std::vector<std::optional<T>> slots_;
+    Emit emit_;
+    size_t next_ = 0;
+    bool emitting_ = false;
+    mutable std::mutex mutex_;
+    mutable std::condition_variable space_;
+};
+
+} // namespace droplet
@@ -0,0 +1,534 @@
+#include "droplet_engine/pipeline.hpp"
+#include "droplet_engine/binary_boundary.hpp"
+#include "droplet_engine/bit_mask.hpp"
+#include "droplet_engine/distance_morphology.hpp"
+#include "droplet_engine/fixed_gaussian.hpp"
+#include "droplet_engine/fused_segment.hpp"
+#include "droplet_engine/morphology.hpp"
+
+#include <algorithm>
+
+namespace droplet {
+
+PipelineConfig PipelineConfig::linear_flow() {
+    PipelineConfig config;
+    config.blur_size = 5;
+    config.morphology = { {MorphOp::Dilate, 2}, {MorphOp::Erode, 3}, {MorphOp::Dilate, 1} };
+    config.retrieval_mode = cv::RETR_LIST;
+    config.metrics.circularity = CircularityFormula::Isoperimetric;
+    config.metrics.reject_degenerate = true;
+    return config;
+}
+
+PipelineConfig PipelineConfig::open_close_flow() {
+    PipelineConfig config;
+    config.blur_size = 3;
+    config.morphology = { {MorphOp::Erode, 1}, {MorphOp::Dilate, 1}, {MorphOp::Dilate, 1}, {MorphOp::Erode, 1} };
+    config.retrieval_mode = cv::RETR_EXTERNAL;
+    config.metrics.circularity = CircularityFormula::SqrtRatio;
+    return config;
+}
+
+DropletPipeline::DropletPipeline(const PipelineConfig& config)
+    : config_(config),
+      kernel_(cv::getStructuringElement(config.kernel_shape, cv::Size(config.kernel_size, config.kernel_size))),
+      plan_(plan_morphology(config.morphology, config.kernel_shape, config.kernel_size)) {
+    CV_Assert(!config.blur_difference || config.blur_size == 3 || config.blur_size == 5);
+}
+
+void DropletPipeline::set_background(const cv::Mat& background, bool blurred) {
+    CV_Assert(!background.empty());
+    model_.reset();
+    if (config_.blur_difference) {
+        CV_Assert(!blurred);
+        raw_bg_ = background;
+        blurred_bg_.release();
+    } else if (blurred) {
+        blurred_bg_ = background;
+    } else {
+        gaussian_blur(background, blurred_bg_, config_.blur_size);
+    }
+}
+
+void DropletPipeline::set_background(std::shared_ptr<BackgroundModel> model) {
+    CV_Assert(model && (config_.blur_difference || model->has_kernel(config_.blur_size)));
+    model_ = std::move(model);
+    blurred_bg_.release();
+    raw_bg_.release();
+}
+
+cv::Mat DropletPipeline::blurred_background() const {
+    if (config_.blur_difference) {
+        return cv::Mat();
+    }
+    if (model_) {
+        return model_->blurred(config_.blur_size);
+    }
+    return blurred_bg_;
+}
+
+cv::Mat DropletPipeline::segment_background() const {
+    if (!config_.blur_difference) {
+        return blurred_background();
+    }
+    return model_ ? model_->raw() : raw_bg_;
+}
+
+void DropletPipeline::segment(const cv::Mat& image, cv::Mat& binary) const {
+    PipelineWorkspace workspace;
+    segment(image, binary, workspace);
+}
+
+void DropletPipeline::segment(const cv::Mat& image, const cv::Rect& window, cv::Mat& binary) const {
+    PipelineWorkspace workspace;
+    segment(image, window, binary, workspace);
+}
+
+void DropletPipeline::segment(const cv::Mat& image, cv::Mat& binary, PipelineWorkspace& workspace) const {
+    cv::Mat bg = segment_background();
+    CV_Assert(!bg.empty() && image.size() == bg.size());
+    segment_region(image, bg, binary, workspace);
+}
+
+void DropletPipeline::segment(const cv::Mat& image, const cv::Rect& window, cv::Mat& binary,
+                              PipelineWorkspace& workspace) const {
+    cv::Mat bg = segment_background();
+    CV_Assert(!bg.empty() && image.size() == bg.size());
+    cv::Rect frame(0, 0, image.cols, image.rows);
+    CV_Assert((window & frame) == window && !window.empty());
+
+    // 外圈只用來讓視窗邊緣的模糊值與整張相同，二值化後丟掉
+    int pad = config_.blur_size / 2;
+    cv::Rect outer(window.x - pad, window.y - pad, window.width + 2 * pad, window.height + 2 * pad);
+    outer &= frame;
+    cv::Mat outer_binary;
+    segment_region(image(outer), bg(outer), outer_binary, workspace);
+    binary = outer_binary(cv::Rect(window.x - outer.x, window.y - outer.y, window.width, window.height));
+}
+
+void DropletPipeline::segment_region(const cv::Mat& image, const cv::Mat& background, cv::Mat& binary,
+                                     PipelineWorkspace& workspace) const {
+    if (config_.blur_difference) {
+        binary = workspace.buffer(PipelineWorkspace::Binary, image.size());
+        droplet::difference_segment(image, background, binary, config_.blur_size, config_.threshold);
+        return;
+    }
+    if (config_.fused_segment && fused_segment_supported(image, config_.blur_size)) {
+        binary = workspace.buffer(PipelineWorkspace::Binary, image.size());
+        droplet::fused_segment(image, background, binary, config_.blur_size, config_.threshold);
+        return;
+    }
+
+    cv::Mat blurred = workspace.buffer(PipelineWorkspace::Blurred, image.size(), image.type());
+    cv::Mat bg_sub = workspace.buffer(PipelineWorkspace::Difference, image.size(), image.type());
+    binary = workspace.buffer(PipelineWorkspace::Binary, image.size(), image.type());
+    gaussian_blur(image, blurred, config_.blur_size);
+    cv::subtract(background, blurred, bg_sub);
+    cv::threshold(bg_sub, binary, config_.threshold, 255, cv::THRESH_BINARY);
+}
+
+bool DropletPipeline::use_tracer() const {
+    return config_.trace_contours && config_.retrieval_mode == cv::RETR_EXTERNAL &&
+           config_.chain_approx == cv::CHAIN_APPROX_NONE;
+}
+
+bool DropletPipeline::use_components() const {
+    return config_.components_first && use_tracer();
+}
+
+int DropletPipeline::morphology_radius() const {
+    int radius = 0;
+    for (const MorphStep& step : config_.morphology) {
+        radius += std::max(0, step.iterations) * (config_.kernel_size / 2);
+    }
+    return radius;
+}
+
+FrameStatus DropletPipeline::crop(cv::Mat& binary, cv::Rect& roi) const {
+    PipelineWorkspace workspace;
+    return crop(binary, roi, workspace);
+}
+
+FrameStatus DropletPipeline::crop(cv::Mat& binary, cv::Rect& roi, PipelineWorkspace& workspace) const {
+    cv::Rect bbox;
+    if (use_components()) {
+        // 連通元件數可能多於外輪廓數（洞中的物體也算一個），只會多拒絕、不會少拒絕
+        BlobLabels& labels = workspace.labels;
+        workspace.runs.assign(binary);
+        label_runs(workspace.runs, labels);
+        if (labels.blobs.empty()) {
+            return FrameStatus::NoContour;
+        }
+        if (labels.blobs.size() > 1) {
+            return FrameStatus::MultipleContours;
+        }
+        bbox = labels.blobs[0].bbox;
+    } else if (config_.trace_contours) {
+        // 裁切只需要輪廓數量與外框，不保存點
+        TraceSummary& summary = workspace.trace;
+        trace_external_contours(binary, summary, false, cv::Point(), &workspace.marks);
+        if (summary.count == 0) {
+            return FrameStatus::NoContour;
+        }
+        if (summary.count > 1) {
+            return FrameStatus::MultipleContours;
+        }
+        bbox = summary.largest.bbox;
+    } else {
+        std::vector<std::vector<cv::Point>> contours;
+        cv::findContours(binary, contours, workspace.hierarchy, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_NONE);
+        if (contours.empty()) {
+            return FrameStatus::NoContour;
+        }
+        if (contours.size() > 1) {
+            return FrameStatus::MultipleContours;
+        }
+        bbox = cv::boundingRect(contours[0]);
+    }
+
+    int padding = config_.crop_padding;
+    roi = bbox;
+    roi.x = std::max(0, roi.x - padding);
+    roi.y = std::max(0, roi.y - padding);
+    roi.width = std::min(binary.cols - roi.x, roi.width + 2 * padding);
+    roi.height = std::min(binary.rows - roi.y, roi.height + 2 * padding);
+    binary = binary(roi);
+    return FrameStatus::Ok;
+}
+
+void DropletPipeline::clean(const cv::Mat& binary, cv::Mat& cleaned) const {
+    PipelineWorkspace workspace;
+    clean(binary, cleaned, workspace);
+}
+
+void DropletPipeline::clean(const cv::Mat& binary, cv::Mat& cleaned, PipelineWorkspace& workspace) const {
+    if (config_.morph_backend == MorphBackend::BitPacked && binary.type() == CV_8UC1 &&
+        bit_morph_supported(config_.kernel_shape, config_.kernel_size)) {
+        // 只在進出形態學時轉換一次
+        BitMask& mask = workspace.bits;
+        mask.assign(binary);
+        run_bit_morphology(config_.morphology, config_.kernel_shape, config_.kernel_size, mask, mask);
+        cleaned = workspace.buffer(PipelineWorkspace::MorphA, binary.size());
+        mask.to_mat(cleaned);
+        return;
+    }
+
+    // 兩塊緩衝輪流作為輸出，不與輸入重疊
+    cv::Mat buffers[2] = { workspace.buffer(PipelineWorkspace::MorphA, binary.size(), binary.type()),
+                           workspace.buffer(PipelineWorkspace::MorphB, binary.size(), binary.type()) };
+    DistanceMetric metric;
+    int radius;
+    if (config_.morph_backend == MorphBackend::Distance && binary.type() == CV_8UC1 &&
+        distance_morph_kernel(config_.kernel_shape, config_.kernel_size, metric, radius)) {
+        run_distance_morphology(config_.morphology, metric, radius, binary, cleaned, workspace.distance,
+                                buffers[0], buffers[1]);
+        return;
+    }
+    if (config_.morph_backend == MorphBackend::Planned || config_.morph_backend == MorphBackend::BitPacked ||
+        config_.morph_backend == MorphBackend::Distance) {
+        // 裁切後的 ROI 外圍都是 0（只有一個輪廓），視為獨立影像與 OpenCV 結果相同
+        run_morphology_plan(plan_, binary, cleaned, buffers[0], buffers[1]);
+        return;
+    }
+
+    cv::Mat src = binary;
+    int next = 0;
+    for (const MorphStep& step : config_.morphology) {
+        if (config_.morph_backend == MorphBackend::Parallel) {
+            for (int i = 0; i < step.iterations; ++i) {
+                if (step.op == MorphOp::Erode) {
+                    parallel_erode(src, buffers[next], kernel_);
+                } else {
+                    parallel_dilate(src, buffers[next], kernel_);
+                }
+                src = buffers[next];
+                next ^= 1;
+            }
+        } else {
+            if (step.op == MorphOp::Erode) {
+                cv::erode(src, buffers[next], kernel_, cv::Point(-1, -1), step.iterations, kIsolatedBorder,
+                          cv::morphologyDefaultBorderValue());
+            } else {
+                cv::dilate(src, buffers[next], kernel_, cv::Point(-1, -1), step.iterations, kIsolatedBorder,
+                           cv::morphologyDefaultBorderValue());
+            }
+            src = buffers[next];
+            next ^= 1;
+        }
+    }
+    cleaned = src;
+}
+
+void DropletPipeline::extract_edges(const cv::Mat& cleaned, cv::Mat& edge) const {
+    PipelineWorkspace workspace;
+    extract_edges(cleaned, edge, workspace);
+}
+
+void DropletPipeline::extract_edges(const cv::Mat& cleaned, cv::Mat& edge, PipelineWorkspace& workspace) const {
+    if (config_.edge == EdgeMode::Canny) {
+        edge = workspace.buffer(PipelineWorkspace::Edge, cleaned.size());
+        cv::Canny(cleaned, edge, config_.canny_low, config_.canny_high);
+    } else if (config_.edge == EdgeMode::Boundary) {
+        edge = workspace.buffer(PipelineWorkspace::Edge, cleaned.size());
+        binary_boundary(cleaned, edge);
+    } else {
+        edge = cleaned;
+    }
+}
+
+void DropletPipeline::find_contours(const cv::Mat& edge, std::vector<std::vector<cv::Point>>& contours,
+                                    cv::Point offset) const {
+    std::vector<cv::Vec4i> hierarchy;
+    cv::findContours(edge, contours, hierarchy, config_.retrieval_mode, config_.chain_approx, offset);
+}
+
+void DropletPipeline::find_contours(const cv::Mat& edge, std::vector<std::vector<cv::Point>>& contours,
+                                    cv::Point offset, PipelineWorkspace& workspace) const {
+    cv::findContours(edge, contours, workspace.hierarchy, config_.retrieval_mode, config_.chain_approx, offset);
+}
+
+ContourMetrics DropletPipeline::measure(const std::vector<std::vector<cv::Point>>& contours,
+                                        const cv::Size& frame_size) const {
+    PipelineWorkspace workspace;
+    ContourMetrics metrics = measure(contours, frame_size, workspace);
+    metrics.detach();
+    return metrics;
+}
+
+ContourMetrics DropletPipeline::measure(const std::vector<std::vector<cv::Point>>& contours,
+                                        const cv::Size& frame_size, PipelineWorkspace& workspace) const {
+    if (config_.require_single_complete && !contours.empty()) {
+        ContourMetrics rejected;
+        if (contours.size() > 1) {
+            rejected.status = FrameStatus::MultipleContours;
+            return rejected;
+        }
+        if (!is_contour_complete(contours[0], frame_size)) {
+            rejected.status = FrameStatus::IncompleteContour;
+            return rejected;
+        }
+    }
+    return calculate_contour_metrics(contours, config_.metrics, &workspace.points);
+}
+
+ContourMetrics DropletPipeline::measure_runs(const cv::Mat& image) const {
+    PipelineWorkspace workspace;
+    ContourMetrics metrics = measure_runs(image, workspace);
+    metrics.detach();
+    return metrics;
+}
+
+ContourMetrics DropletPipeline::measure_runs(const cv::Mat& image, PipelineWorkspace& workspace) const {
+    if (config_.morphology.empty() &&
+        (config_.blur_difference || (config_.fused_segment && fused_segment_supported(image, config_.blur_size)))) {
+        cv::Mat bg = segment_background();
+        CV_Assert(!bg.empty() && image.size() == bg.size());
+        if (config_.blur_difference) {
+            droplet::difference_segment(image, bg, workspace.runs, config_.blur_size, config_.threshold);
+        } else {
+            droplet::fused_segment(image, bg, workspace.runs, config_.blur_size, config_.threshold);
+        }
+    } else {
+        cv::Mat binary, cleaned;
+        segment(image, binary, workspace);
+        clean(binary, cleaned, workspace);
+        workspace.runs.assign(cleaned);
+    }
+    return measure_largest_blob(workspace.runs, workspace.labels, config_.metrics, config_.require_single_complete,
+                                &workspace.points);
+}
+
+ContourMetrics DropletPipeline::measure_traced(const cv::Mat& edge, cv::Point offset, const cv::Size& frame_size,
+                                               std::vector<std::vector<cv::Point>>& contours) const {
+    PipelineWorkspace workspace;
+    ContourMetrics metrics = measure_traced(edge, offset, frame_size, contours, workspace);
+    metrics.detach();
+    return metrics;
+}
+
+ContourMetrics DropletPipeline::measure_traced(const cv::Mat& edge, cv::Point offset, const cv::Size& frame_size,
+                                               std::vector<std::vector<cv::Point>>& contours,
+                                               PipelineWorkspace& workspace) const {
+    TraceSummary& summary = workspace.trace;
+    trace_external_contours(edge, summary, true, offset, &workspace.marks);
+    if (summary.count == 0) {
+        return ContourMetrics();
+    }
+    if (config_.require_single_complete) {
+        // 外框碰到影像邊界 <=> is_contour_complete 為 false
+        ContourMetrics rejected;
+        const cv::Rect& bbox = summary.largest.bbox;
+        if (summary.count > 1) {
+            rejected.status = FrameStatus::MultipleContours;
+            return rejected;
+        }
+        if (bbox.x <= 0 || bbox.y <= 0 || bbox.br().x >= frame_size.width || bbox.br().y >= frame_size.height) {
+            rejected.status = FrameStatus::IncompleteContour;
+            return rejected;
+        }
+    }
+    ContourMetrics metrics = measure_traced_contour(summary.largest, config_.metrics, &workspace.points);
+    workspace.add_contour(contours).assign(summary.largest.points.begin(), summary.largest.points.end());
+    return metrics;
+}
+
+ContourMetrics DropletPipeline::measure_components(const cv::Mat& cleaned, cv::Point offset,
+                                                   const cv::Size& frame_size,
+                                                   std::vector<std::vector<cv::Point>>& contours) const {
+    PipelineWorkspace workspace;
+    ContourMetrics metrics = measure_components(cleaned, offset, frame_size, contours, workspace);
+    metrics.detach();
+    return metrics;
+}
+
+ContourMetrics DropletPipeline::measure_components(const cv::Mat& cleaned, cv::Point offset,
+                                                   const cv::Size& frame_size,
+                                                   std::vector<std::vector<cv::Point>>& contours,
+                                                   PipelineWorkspace& workspace) const {
+    RunLengthMask& runs = workspace.runs;
+    BlobLabels& labels = workspace.labels;
+    runs.assign(cleaned);
+    label_runs(runs, labels);
+    if (labels.blobs.empty()) {
+        return ContourMetrics();
+    }
+
+    int winner = largest_blob(labels);
+    const cv::Rect& bbox = labels.blobs[winner].bbox;
+    if (config_.require_single_complete) {
+        ContourMetrics rejected;
+        cv::Rect frame_box = bbox + offset;
+        if (labels.blobs.size() > 1) {
+            rejected.status = FrameStatus::MultipleContours;
+            return rejected;
+        }
+        if (frame_box.x <= 0 || frame_box.y <= 0 || frame_box.br().x >= frame_size.width ||
+            frame_box.br().y >= frame_size.height) {
+            rejected.status = FrameStatus::IncompleteContour;
+            return rejected;
+        }
+    }
+
+    // Canny 的 Sobel 與非極大值抑制只看 2 像素內，外框外留 3 像素即與整張影像相同
+    const int margin = 3;
+    cv::Rect box(bbox.x - margin, bbox.y - margin, bbox.width + 2 * margin, bbox.height + 2 * margin);
+    box &= cv::Rect(0, 0, cleaned.cols, cleaned.rows);
+
+    cv::Mat blob = workspace.buffer(PipelineWorkspace::Blob, box.size());
+    cv::Mat edge;
+    render_blob(runs, labels, winner, box, blob);
+    extract_edges(blob, edge, workspace);
+    return measure_traced(edge, offset + box.tl(), frame_size, contours, workspace);
+}
+
+ContourMetrics DropletPipeline::process(const cv::Mat& image) const {
+    std::vector<std::vector<cv::Point>> contours;
+    return process(image, contours);
+}
+
+ContourMetrics DropletPipeline::process(const cv::Mat& image, std::vector<std::vector<cv::Point>>& contours) const {
+    // 暫時的 workspace 隨函式結束釋放，點改由結果自己持有
+    PipelineWorkspace workspace;
+    ContourMetrics metrics = process(image, contours, workspace);
+    metrics.detach();
+    return metrics;
+}
+
+ContourMetrics DropletPipeline::process(const cv::Mat& image, const cv::Rect& window,
+                                        std::vector<std::vector<cv::Point>>& contours) const {
+    PipelineWorkspace workspace;
+    ContourMetrics metrics = process(image, window, contours, workspace);
+    metrics.detach();
+    return metrics;
+}
+
+ContourMetrics DropletPipeline::process_tracked(const cv::Mat& image, RoiTracker& tracker,
+                                                std::vector<std::vector<cv::Point>>& contours) const {
+    PipelineWorkspace workspace;
+    ContourMetrics metrics = process_tracked(image, tracker, contours, workspace);
+    metrics.detach();
+    return metrics;
+}
+
+ContourMetrics DropletPipeline::process(const cv::Mat& image, std::vector<std::vector<cv::Point>>& contours,
+                                        PipelineWorkspace& workspace) const {
+    workspace.recycle(contours);
+    workspace.points.reset();
+
+    if (config_.measure_runs && config_.edge == EdgeMode::None && !config_.crop_to_droplet) {
+        ContourMetrics metrics = measure_runs(image, workspace);
+        if (!metrics.contour.empty()) {
+            workspace.add_contour(contours).assign(metrics.contour.begin(), metrics.contour.end());
+        }
+        return metrics;
+    }
+
+    cv::Mat binary;
+    segment(image, binary, workspace);
+    return process_binary(binary, cv::Point(), image.size(), contours, workspace);
+}
+
+ContourMetrics DropletPipeline::process(const cv::Mat& image, const cv::Rect& window,
+                                        std::vector<std::vector<cv::Point>>& contours,
+                                        PipelineWorkspace& workspace) const {
+    workspace.recycle(contours);
+    workspace.points.reset();
+    cv::Mat binary;
+    segment(image, window, binary, workspace);
+    return process_binary(binary, window.tl(), image.size(), contours, workspace);
+}
+
+ContourMetrics DropletPipeline::process_tracked(const cv::Mat& image, RoiTracker& tracker,
+                                                std::vector<std::vector<cv::Point>>& contours,
+                                                PipelineWorkspace& workspace) const {
+    cv::Rect window;
+    if (tracker.predict(image.size(), window)) {
+        ContourMetrics metrics = process(image, window, contours, workspace);
+        cv::Rect bbox = bounding_rect(metrics.contour);
+        bool hit = metrics.ok() && !metrics.contour.empty() &&
+                   tracker.contains(window, image.size(), bbox, morphology_radius());
+        tracker.record(hit);
+        if (hit) {
+            tracker.update(bbox);
+            return metrics;
+        }
+    }
+
+    ContourMetrics metrics = process(image, contours, workspace);
+    if (metrics.ok() && !metrics.contour.empty()) {
+        tracker.update(bounding_rect(metrics.contour));
+    } else {
+        tracker.reset();
+    }
+    return metrics;
+}
+
+ContourMetrics DropletPipeline::process_binary(cv::Mat& binary, cv::Point offset, const cv::Size& frame_size,
+                                               std::vector<std::vector<cv::Point>>& contours,
+                                               PipelineWorkspace& workspace) const {
+    cv::Rect roi(0, 0, binary.cols, binary.rows);
+    if (config_.crop_to_droplet) {
+        FrameStatus status = crop(binary, roi, workspace);
+        if (status != FrameStatus::Ok) {
+            ContourMetrics rejected;
+            rejected.status = status;
+            return rejected;
+        }
+    }
+    offset += roi.tl();
+
+    cv::Mat cleaned, edge;
+    clean(binary, cleaned, workspace);
+    if (use_components()) {
+        return measure_components(cleaned, offset, frame_size, contours, workspace);
+    }
+    extract_edges(cleaned, edge, workspace);
+    if (use_tracer()) {
+        return measure_traced(edge, offset, frame_size, contours, workspace);
+    }
+    find_contours(edge, contours, offset, workspace);
+
+    return measure(contours, frame_size, workspace);
+}
+
+} // namespace droplet
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "droplet_engine/background_model.hpp"
+#include "droplet_engine/boundary_tracer.hpp"
+#include "droplet_engine/contour_metrics.hpp"
+#include "droplet_engine/morphology_plan.hpp"
+#include "droplet_engine/pipeline_workspace.hpp"
+#include "droplet_engine/roi_tracker.hpp"
+#include "droplet_engine/run_length.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <vector>
+
+namespace droplet {
+
+enum class MorphBackend {
+    OpenCV,     // cv::erode / cv::dilate，逐次迭代
+    Parallel,   // parallel_erode / parallel_dilate（SIMD、van Herk），逐次迭代
+    Planned,    // plan_morphology 化簡後的最少掃描次數，結果與 OpenCV 相同
+    BitPacked,  // BitMask 每像素 1 bit；十字 / 矩形以外的形狀退回 Planned
+    Distance    // 每段一次距離場再門檻，成本與核大小無關；橢圓近似為圓盤，不支援的形狀退回 Planned
+};
+
+enum class EdgeMode {
+    None,       // 直接在二值影像上找輪廓
+    Canny,      // cv::Canny(cleaned, canny_low, canny_high)
+    Boundary    // binary_boundary：mask AND NOT 腐蝕後的 mask，一次 SIMD 掃描，不算梯度；
+                // 輪廓位於前景內側，碰到影像邊緣的區塊沿影像邊緣閉合（外輪廓與 None 相同）；
+                // Canny 在二值影像的直線段上保留階梯左 / 上方的像素，面積與周長略有差異
+};
+
+struct PipelineConfig {
+    int blur_size = 3;
+    double threshold = 10;
+    // 模糊、背景相減與二值化合併為單次掃描（fused_segment），結果逐位元相同
+    bool fused_segment = true;
+    // 背景不模糊，改為模糊有號差值 background - image 一次（difference_segment）；只支援 blur_size = 3 / 5。
+    // 與兩邊各自模糊的結果只在模糊後差值距離門檻不到 1 個灰階的像素可能不同
+    bool blur_difference = false;
+
+    int kernel_shape = cv::MORPH_CROSS;
+    int kernel_size = 3;
+    std::vector<MorphStep> morphology;
+    MorphBackend morph_backend = MorphBackend::Planned;
+
+    EdgeMode edge = EdgeMode::Canny;
+    double canny_low = 50;
+    double canny_high = 150;
+
+    int retrieval_mode = cv::RETR_EXTERNAL;
+    int chain_approx = cv::CHAIN_APPROX_NONE;
+
+    // EdgeMode::None 且不裁切時，以 run-length blob 直接量測最大液滴，不呼叫 findContours；
+    // 沒有形態學步驟時 runs 在二值化的同一次掃描中產生
+    bool measure_runs = false;
+
+    // RETR_EXTERNAL + CHAIN_APPROX_NONE 時以 trace_external_contours 取代 findContours：
+    // 面積、周長、外框與邊界檢查在追蹤時累加，只保留最大輪廓的點
+    bool trace_contours = false;
+
+    // 形態學之後先以連通元件統計（面積、外框、是否碰邊界）挑出最大液滴，
+    // 多個或不完整時在追蹤前就拒絕；只在最大元件的外框範圍內做邊緣與追蹤。
+    // 裁切也改用元件外框，不再呼叫 findContours。需要 trace_contours 的條件才會生效
+    bool components_first = false;
+
+    // process_image_cropped：先在二值圖上找液滴外框，裁切後再做形態學
+    bool crop_to_droplet = false;
+    int crop_padding = 30;
+
+    // crop_canny / crop_test：只接受單一且未碰到邊界的輪廓
+    bool require_single_complete = false;
+
+    // 注意：帶 window 的 process 與 process_tracked 命中視窗時只看視窗內的像素，
+    // 上面兩項的「多個輪廓」拒絕不涵蓋視窗外的液滴（視窗外另有液滴時仍會接受）；
+    // 需要整張檢查時改用不帶 window 的 process
+
+    MetricsOptions metrics;
+
+    // 原始線性流程：5x5 模糊，dilate x2 -> erode x3 -> dilate x1，RETR_LIST
+    static PipelineConfig linear_flow();
+    // canny.cpp 系列：3x3 模糊，erode -> dilate -> dilate -> erode，RETR_EXTERNAL
+    static PipelineConfig open_close_flow();
+};
+
+// 可依階段設定的液滴處理流程；背景只模糊一次，之後各執行緒共用（唯讀）
+class DropletPipeline {
+public:
+    explicit DropletPipeline(const PipelineConfig& config = PipelineConfig::open_close_flow());
+
+    // blurred = true 表示呼叫端已經模糊過背景（blur_difference 時不可）
+    void set_background(const cv::Mat& background, bool blurred = false);
+    // 背景隨空白影像更新時使用；每次二值化取目前版本（模型需含 blur_size 的模糊背景；
+    // blur_difference 時只用原始背景，模型可不含任何 kernel 大小）
+    void set_background(std::shared_ptr<BackgroundModel> model);
+
+    const PipelineConfig& config() const { return config_; }
+    // 回傳的 Mat 與背景共用資料（含參考計數），模型更新後仍保持有效；blur_difference 時為空
+    cv::Mat blurred_background() const;
+    const std::shared_ptr<BackgroundModel>& background_model() const { return model_; }
+    const cv::Mat& kernel() const { return kernel_; }
+    // 整串形態學步驟的總半徑（各步 iterations * kernel_size / 2 相加）：邊界值最多影響到離邊緣這麼遠的像素
+    int morphology_radius() const;
+
+    // 各階段，可單獨呼叫（ypc.cpp 的分段管線）
+    void segment(const cv::Mat& image, cv::Mat& binary) const;
+    // 只二值化 window 範圍；模糊多讀 blur_size / 2 的外圈，結果與整張二值化後再裁切相同
+    void segment(const cv::Mat& image, const cv::Rect& window, cv::Mat& binary) const;
+    FrameStatus crop(cv::Mat& binary, cv::Rect& roi) const;
+    void clean(const cv::Mat& binary, cv::Mat& cleaned) const;
+    void extract_edges(const cv::Mat& cleaned, cv::Mat& edge) const;
+    void find_contours(const cv::Mat& edge, std::vector<std::vector<cv::Point>>& contours,
+                       cv::Point offset = cv::Point()) const;
+    ContourMetrics measure(const std::vector<std::vector<cv::Point>>& contours, const cv::Size& frame_size) const;
+    ContourMetrics measure_runs(const cv::Mat& image) const;
+    ContourMetrics measure_traced(const cv::Mat& edge, cv::Point offset, const cv::Size& frame_size,
+                                  std::vector<std::vector<cv::Point>>& contours) const;
+    ContourMetrics measure_components(const cv::Mat& cleaned, cv::Point offset, const cv::Size& frame_size,
+                                      std::vector<std::vector<cv::Point>>& contours) const;
+
+    // 各階段的 workspace 版本：中間結果寫入 workspace（每個 worker 一份），輸出 Mat 為其中的 ROI，
+    // 下一次使用同一個 workspace 時會被覆寫。不帶 workspace 的版本每次使用一份新的 workspace
+    void segment(const cv::Mat& image, cv::Mat& binary, PipelineWorkspace& workspace) const;
+    void segment(const cv::Mat& image, const cv::Rect& window, cv::Mat& binary, PipelineWorkspace& workspace) const;
+    FrameStatus crop(cv::Mat& binary, cv::Rect& roi, PipelineWorkspace& workspace) const;
+    void clean(const cv::Mat& binary, cv::Mat& cleaned, PipelineWorkspace& workspace) const;
+    void extract_edges(const cv::Mat& cleaned, cv::Mat& edge, PipelineWorkspace& workspace) const;
+    void find_contours(const cv::Mat& edge, std::vector<std::vector<cv::Point>>& contours, cv::Point offset,
+                       PipelineWorkspace& workspace) const;
+    ContourMetrics measure(const std::vector<std::vector<cv::Point>>& contours, const cv::Size& frame_size,
+                           PipelineWorkspace& workspace) const;
+    ContourMetrics measure_runs(const cv::Mat& image, PipelineWorkspace& workspace) const;
+    ContourMetrics measure_traced(const cv::Mat& edge, cv::Point offset, const cv::Size& frame_size,
+                                  std::vector<std::vector<cv::Point>>& contours, PipelineWorkspace& workspace) const;
+    ContourMetrics measure_components(const cv::Mat& cleaned, cv::Point offset, const cv::Size& frame_size,
+                                      std::vector<std::vector<cv::Point>>& contours,
+                                      PipelineWorkspace& workspace) const;
+
+    ContourMetrics process(const cv::Mat& image) const;
+    ContourMetrics process(const cv::Mat& image, std::vector<std::vector<cv::Point>>& contours) const;
+    // 只處理 window 內的像素，輪廓為影像座標。window 視為獨立影像：形態學在 window 邊緣使用預設邊界值，
+    // 裁切與單一輪廓檢查只看 window 內
+    ContourMetrics process(const cv::Mat& image, const cv::Rect& window,
+                           std::vector<std::vector<cv::Point>>& contours) const;
+    // 先處理 tracker 預測的視窗；失敗或液滴離視窗邊緣少於 max(guard, morphology_radius()) 時再處理整張，並更新 tracker。
+    // 需要 metrics.keep_points（以輪廓點求外框）
+    ContourMetrics process_tracked(const cv::Mat& image, RoiTracker& tracker,
+                                   std::vector<std::vector<cv::Point>>& contours) const;
+
+    // 同上，中間結果寫入 workspace；影像大小不變時穩態不配置新的 Mat。每張影像傳入同一個 contours 時，
+    // 不經過 findContours / Canny 的流程（trace_contours、measure_runs、EdgeMode::Boundary）暖機後不再配置任何記憶體。
+    // 結果的點在 workspace.points 中，同一個 workspace 處理下一張影像時失效（需要保留時呼叫 detach）
+    ContourMetrics process(const cv::Mat& image, std::vector<std::vector<cv::Point>>& contours,
+                           PipelineWorkspace& workspace) const;
+    ContourMetrics process(const cv::Mat& image, const cv::Rect& window,
+                           std::vector<std::vector<cv::Point>>& contours, PipelineWorkspace& workspace) const;
+    ContourMetrics process_tracked(const cv::Mat& image, RoiTracker& tracker,
+                                   std::vector<std::vector<cv::Point>>& contours, PipelineWorkspace& workspace) const;
+
+private:
+    bool use_tracer() const;
+    bool use_components() const;
+    // 二值化比較的背景：blur_difference 時為原始背景，否則為模糊後的背景
+    cv::Mat segment_background() const;
+    void segment_region(const cv::Mat& image, const cv::Mat& background, cv::Mat& binary,
+                        PipelineWorkspace& workspace) const;
+    ContourMetrics process_binary(cv::Mat& binary, cv::Point offset, const cv::Size& frame_size,
+                                  std::vector<std::vector<cv::Point>>& contours, PipelineWorkspace& workspace) const;
+
+    PipelineConfig config_;
+    cv::Mat kernel_;
+    MorphPlan plan_;
+    cv::Mat blurred_bg_;
+    cv::Mat raw_bg_;
+    std::shared_ptr<BackgroundModel> model_;
+};
+
+} // namespace droplet
@@ -0,0 +1,38 @@
+#include "droplet_engine/pipeline_workspace.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace droplet {
+
+cv::Mat PipelineWorkspace::buffer(Buffer which, cv::Size size, int type) {
+    cv::Mat& storage = storage_[which];
+    if (storage.empty() || storage.type() != type || storage.cols < size.width || storage.rows < size.height) {
+        int rows = std::max(size.height, storage.type() == type ? storage.rows : 0);
+        int cols = std::max(size.width, storage.type() == type ? storage.cols : 0);
+        // 呼叫端仍持有的舊 ROI 保持有效
+        storage = cv::Mat(rows, cols, type);
+        ++allocations_;
+    }
+    return storage(cv::Rect(0, 0, size.width, size.height));
+}
+
+void PipelineWorkspace::recycle(std::vector<std::vector<cv::Point>>& contours) {
+    for (std::vector<cv::Point>& contour : contours) {
+        contour.clear();
+        spare_contours_.push_back(std::move(contour));
+    }
+    contours.clear();
+}
+
+std::vector<cv::Point>& PipelineWorkspace::add_contour(std::vector<std::vector<cv::Point>>& contours) {
+    if (spare_contours_.empty()) {
+        contours.emplace_back();
+    } else {
+        contours.push_back(std::move(spare_contours_.back()));
+        spare_contours_.pop_back();
+    }
+    return contours.back();
+}
+
+} // namespace droplet
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "droplet_engine/bit_mask.hpp"
+#include "droplet_engine/boundary_tracer.hpp"
+#include "droplet_engine/distance_morphology.hpp"
+#include "droplet_engine/point_arena.hpp"
+#include "droplet_engine/run_length.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace droplet {
+
+// 一個 worker 專用的中間緩衝：二值化、形態學 ping-pong、邊緣、液滴 ROI，以及 run-length 與標記。
+// Mat 只會變大不會縮小，取用時回傳左上角大小剛好的 ROI；影像大小固定、裁切大小不超過曾見過的
+// 最大值時，各階段都就地寫入，穩態下每張影像不再配置新的 Mat；其他緩衝也只增不減，
+// 搭配各模組每個執行緒一份的暫存，追蹤 / 元件 / run-length 流程在暖機後不再配置任何記憶體
+// （findContours、Canny 等 OpenCV 函式除外）。
+// 回傳的 Mat 在下一次使用同一個 workspace 時會被覆寫。不可跨執行緒共用（WorkerLocal 每個 worker 一份）。
+class PipelineWorkspace {
+public:
+    enum Buffer { Blurred, Difference, Binary, MorphA, MorphB, Edge, Blob, BufferCount };
+
+    // 容量不足或型別不同時重新配置（計入 allocations）。回傳的 ROI 之外是上一次的舊資料：
+    // 交給 cv::erode / cv::dilate 等會讀 ROI 外鄰居的函式時要加 BORDER_ISOLATED（kIsolatedBorder）
+    cv::Mat buffer(Buffer which, cv::Size size, int type = CV_8UC1);
+
+    // Mat 配置的次數（含第一次）；暖機之後應保持不變
+    uint64_t allocations() const { return allocations_; }
+
+    // 輸出的輪廓：recycle 清空 contours 並收回其中的 vector（保留容量），add_contour 優先取用收回的 vector。
+    // 每張影像傳入同一個 contours 時穩態下不再配置
+    void recycle(std::vector<std::vector<cv::Point>>& contours);
+    std::vector<cv::Point>& add_contour(std::vector<std::vector<cv::Point>>& contours);
+
+    RunLengthMask runs;
+    BlobLabels labels;
+    std::vector<uchar> marks;           // trace_external_contours 的標記影像
+    std::vector<cv::Vec4i> hierarchy;
+    DistanceField distance;             // MorphBackend::Distance 的距離場
+    BitMask bits;                       // MorphBackend::BitPacked 的輸入與結果
+    TraceSummary trace;                 // trace_external_contours 的結果（含最大輪廓的點）
+    // 結果中的輪廓與凸包點；process 開始時 reset，單獨呼叫各階段時由呼叫端 reset
+    PointArena points;
+
+private:
+    cv::Mat storage_[BufferCount];
+    uint64_t allocations_ = 0;
+    std::vector<std::vector<cv::Point>> spare_contours_;
+};
+
+} // namespace droplet
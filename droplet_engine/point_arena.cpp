@@ -0,0 +1,60 @@
+#include "droplet_engine/point_arena.hpp"
+
+#include <algorithm>
+#include <climits>
+
+namespace droplet {
+
+cv::Rect bounding_rect(const PointSpan& points) {
+    if (points.empty()) {
+        return cv::Rect();
+    }
+    int x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN;
+    for (const cv::Point& point : points) {
+        x0 = std::min(x0, point.x);
+        y0 = std::min(y0, point.y);
+        x1 = std::max(x1, point.x);
+        y1 = std::max(y1, point.y);
+    }
+    return cv::Rect(x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+}
+
+PointArena::PointArena(size_t block_points) : block_points_(std::max<size_t>(block_points, 1)) {
+}
+
+cv::Point* PointArena::allocate(size_t n) {
+    if (n == 0) {
+        return nullptr;
+    }
+    for (; current_ < blocks_.size(); ++current_, offset_ = 0) {
+        std::vector<cv::Point>& block = blocks_[current_];
+        if (offset_ + n <= block.size()) {
+            cv::Point* points = block.data() + offset_;
+            offset_ += n;
+            used_ += n;
+            return points;
+        }
+    }
+
+    // 區塊本身的記憶體不會因 blocks_ 擴充而搬移
+    block_points_ = std::max(block_points_, n);
+    blocks_.emplace_back(block_points_);
+    current_ = blocks_.size() - 1;
+    offset_ = n;
+    used_ += n;
+    return blocks_.back().data();
+}
+
+PointSpan PointArena::store(const cv::Point* points, size_t n) {
+    cv::Point* dst = allocate(n);
+    std::copy(points, points + n, dst);
+    return PointSpan(dst, n);
+}
+
+void PointArena::reset() {
+    current_ = 0;
+    offset_ = 0;
+    used_ = 0;
+}
+
+} // namespace droplet
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <vector>
+
+namespace droplet {
+
+// 連續點的唯讀視圖（C++17 沒有 std::span），不持有資料
+class PointSpan {
+public:
+    PointSpan() = default;
+    PointSpan(const cv::Point* data, size_t size) : data_(data), size_(size) {}
+
+    const cv::Point* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const cv::Point* begin() const { return data_; }
+    const cv::Point* end() const { return data_ + size_; }
+    const cv::Point& operator[](size_t i) const { return data_[i]; }
+
+    // 畫圖（drawContours）等需要 vector 的地方才複製
+    std::vector<cv::Point> to_vector() const { return std::vector<cv::Point>(begin(), end()); }
+
+private:
+    const cv::Point* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// 與 cv::boundingRect 相同；空的視圖回傳空矩形
+cv::Rect bounding_rect(const PointSpan& points);
+
+// 一張影像的點暫存（bump allocator）：配置只是往後移動位置，reset() 一次放掉整張影像的點，
+// 區塊保留給下一張影像，暖機後不再配置。已配置的點在 reset 前不會搬移。
+class PointArena {
+public:
+    explicit PointArena(size_t block_points = 1 << 14);
+
+    // n 個連續的點；目前區塊放不下時改用下一個區塊（必要時新增）
+    cv::Point* allocate(size_t n);
+    PointSpan store(const cv::Point* points, size_t n);
+    PointSpan store(const PointSpan& points) { return store(points.data(), points.size()); }
+    PointSpan store(const std::vector<cv::Point>& points) { return store(points.data(), points.size()); }
+
+    void reset();
+
+    // 目前這張影像使用的點數
+    size_t used() const { return used_; }
+    // 配置過的區塊數；暖機之後應保持不變
+    size_t blocks() const { return blocks_.size(); }
+
+private:
+    std::vector<std::vector<cv::Point>> blocks_;
+    size_t block_points_;
+    size_t current_ = 0;
+    size_t offset_ = 0;
+    size_t used_ = 0;
+};
+
+} // namespace droplet
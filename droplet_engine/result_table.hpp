@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace droplet {
+
+// 依影像索引預先配置的結果表：第 i 格只由處理第 i 張的 worker 寫入一次，不需要鎖；
+// 每格獨立佔 cache line，相鄰索引由不同 worker 寫入時不會互相干擾（false sharing）。
+// 處理時間與結果放在同一格，順序永遠對得上。
+// 讀取要在所有 worker 結束之後（join、parallel 區段或 WorkerPool::run 返回），或經由其他同步（OrderedSink）。
+template <typename T>
+class ResultTable {
+public:
+    struct alignas(64) Slot {
+        T value = T();
+        double time = 0;
+        bool done = false;      // 讀檔失敗等未寫入的格子為 false
+    };
+
+    explicit ResultTable(size_t count) : slots_(count) {}
+
+    size_t size() const { return slots_.size(); }
+
+    void set(size_t index, T value, double time) {
+        Slot& slot = slots_[index];
+        slot.value = std::move(value);
+        slot.time = time;
+        slot.done = true;
+    }
+
+    const Slot& operator[](size_t index) const { return slots_[index]; }
+
+    // 已寫入的格數與處理時間總和
+    size_t done_count() const {
+        size_t count = 0;
+        for (const Slot& slot : slots_) {
+            count += slot.done;
+        }
+        return count;
+    }
+
+    double total_time() const {
+        double total = 0;
+        for (const Slot& slot : slots_) {
+            if (slot.done) {
+                total += slot.time;
+            }
+        }
+        return total;
+    }
+
+    double average_time() const {
+        size_t count = done_count();
+        return count > 0 ? total_time() / count : 0;
+    }
+
+private:
+    std::vector<Slot> slots_;
+};
+
+} // namespace droplet
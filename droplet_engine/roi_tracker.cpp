@@ -0,0 +1,71 @@
+#include "droplet_engine/roi_tracker.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace droplet {
+
+RoiTracker::RoiTracker(const RoiTrackerConfig& config) : config_(config) {
+    CV_Assert(config_.history >= 1 && config_.margin >= 0 && config_.guard >= 0);
+}
+
+bool RoiTracker::predict(const cv::Size& frame_size, cv::Rect& window) const {
+    if (boxes_.empty()) {
+        return false;
+    }
+
+    // 中心點的平均位移與最近幾張的最大尺寸
+    const cv::Rect& last = boxes_.back();
+    double vx = 0, vy = 0;
+    int width = last.width, height = last.height;
+    if (boxes_.size() > 1) {
+        const cv::Rect& first = boxes_.front();
+        double steps = (double)(boxes_.size() - 1);
+        vx = ((last.x + last.width * 0.5) - (first.x + first.width * 0.5)) / steps;
+        vy = ((last.y + last.height * 0.5) - (first.y + first.height * 0.5)) / steps;
+    }
+    for (const cv::Rect& box : boxes_) {
+        width = std::max(width, box.width);
+        height = std::max(height, box.height);
+    }
+
+    // 位移本身的不確定性也算進邊界
+    int pad_x = config_.margin + (int)std::ceil(std::abs(vx));
+    int pad_y = config_.margin + (int)std::ceil(std::abs(vy));
+    double cx = last.x + last.width * 0.5 + vx;
+    double cy = last.y + last.height * 0.5 + vy;
+    int x0 = (int)std::floor(cx - width * 0.5) - pad_x;
+    int y0 = (int)std::floor(cy - height * 0.5) - pad_y;
+    int x1 = (int)std::ceil(cx + width * 0.5) + pad_x;
+    int y1 = (int)std::ceil(cy + height * 0.5) + pad_y;
+
+    window = cv::Rect(x0, y0, x1 - x0, y1 - y0) & cv::Rect(0, 0, frame_size.width, frame_size.height);
+    if (window.empty()) {
+        return false;
+    }
+    return (double)window.area() <= config_.max_area_fraction * frame_size.area();
+}
+
+bool RoiTracker::contains(const cv::Rect& window, const cv::Size& frame_size, const cv::Rect& bbox,
+                          int min_guard) const {
+    // 與整張影像共用的邊不算切到
+    int guard = std::max(config_.guard, min_guard);
+    bool left = window.x == 0 || bbox.x - window.x >= guard;
+    bool top = window.y == 0 || bbox.y - window.y >= guard;
+    bool right = window.br().x == frame_size.width || window.br().x - bbox.br().x >= guard;
+    bool bottom = window.br().y == frame_size.height || window.br().y - bbox.br().y >= guard;
+    return (bbox & window) == bbox && left && top && right && bottom;
+}
+
+void RoiTracker::update(const cv::Rect& bbox) {
+    boxes_.push_back(bbox);
+    while ((int)boxes_.size() > config_.history) {
+        boxes_.pop_front();
+    }
+}
+
+void RoiTracker::reset() {
+    boxes_.clear();
+}
+
+} // namespace droplet
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <deque>
+
+namespace droplet {
+
+struct RoiTrackerConfig {
+    // 預測外框四周再留的邊（與 crop_padding 同義）
+    int margin = 30;
+    // 用來估計速度的最近幾張外框
+    int history = 4;
+    // 液滴外框離視窗內側邊緣少於 guard 像素時視為被切到，改跑整張；
+    // process_tracked 另以形態學的總半徑為下限（視窗邊緣的邊界值最多影響這麼深）
+    int guard = 2;
+    // 視窗超過整張面積的比例時直接跑整張
+    double max_area_fraction = 0.5;
+};
+
+// 連續擷取時以最近幾張的外框與位移（等速模型）預測下一張的液滴視窗；
+// 只處理視窗內的像素，預測失準時由 DropletPipeline::process_tracked 退回整張。
+// 不是執行緒安全的：同一段連續影像由同一個執行緒依序處理。
+class RoiTracker {
+public:
+    explicit RoiTracker(const RoiTrackerConfig& config = RoiTrackerConfig());
+
+    // 沒有足夠歷史或視窗太大時回傳 false（處理整張）
+    bool predict(const cv::Size& frame_size, cv::Rect& window) const;
+
+    // 液滴外框（影像座標）是否完整落在視窗內，離內側邊緣至少 max(guard, min_guard) 像素
+    bool contains(const cv::Rect& window, const cv::Size& frame_size, const cv::Rect& bbox, int min_guard = 0) const;
+
+    void update(const cv::Rect& bbox);
+    void reset();
+
+    const RoiTrackerConfig& config() const { return config_; }
+    int hits() const { return hits_; }
+    int misses() const { return misses_; }
+    void record(bool hit) { hit ? ++hits_ : ++misses_; }
+
+private:
+    RoiTrackerConfig config_;
+    std::deque<cv::Rect> boxes_;
+    int hits_ = 0;
+    int misses_ = 0;
+};
+
+} // namespace droplet
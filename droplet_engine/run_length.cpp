@@ -0,0 +1,452 @@
+#include "droplet_engine/run_length.hpp"
+#include "droplet_engine/boundary_tracer.hpp"
+#include "droplet_engine/convex_hull.hpp"
+#include "droplet_engine/threading_policy.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <cmath>
+#include <numeric>
+
+namespace droplet {
+
+namespace {
+
+// measure_blob 的暫存，每個執行緒一份；穩態下不再配置
+struct BlobScratch {
+    std::vector<int> left, right;
+    std::vector<cv::Point> contour, endpoints, hull;
+    // 列中有多段 run 時改為追蹤：blob 畫進外擴 1 像素的影像（只會變大，取左上角的 ROI）
+    cv::Mat canvas;
+    std::vector<uchar> marks;
+    TraceSummary trace;
+};
+
+thread_local BlobScratch tls_blob;
+
+int find_root(std::vector<int>& parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+void unite(std::vector<int>& parent, int a, int b) {
+    a = find_root(parent, a);
+    b = find_root(parent, b);
+    if (a != b) {
+        parent[std::max(a, b)] = std::min(a, b);
+    }
+}
+
+// 逐點累加鞋帶公式與周長（與 contourArea / arcLength(closed) 相同的定義）
+class BoundaryWalker {
+public:
+    explicit BoundaryWalker(std::vector<cv::Point>* points) : points_(points) {}
+
+    void move_to(int x, int y) {
+        if (count_ == 0) {
+            first_ = cv::Point(x, y);
+        } else {
+            step(last_, cv::Point(x, y));
+        }
+        last_ = cv::Point(x, y);
+        ++count_;
+        if (points_) {
+            points_->push_back(last_);
+        }
+    }
+
+    void close() {
+        if (count_ > 1 && last_ != first_) {
+            step(last_, first_);
+        }
+    }
+
+    double area() const { return std::abs((double)twice_area_) * 0.5; }
+    double perimeter() const { return straight_ + diagonal_ * std::sqrt(2.0); }
+
+private:
+    void step(const cv::Point& a, const cv::Point& b) {
+        twice_area_ += (int64_t)a.x * b.y - (int64_t)b.x * a.y;
+        if (a.x != b.x && a.y != b.y) {
+            ++diagonal_;
+        } else {
+            ++straight_;
+        }
+    }
+
+    std::vector<cv::Point>* points_;
+    cv::Point first_, last_;
+    int64_t count_ = 0;
+    int64_t twice_area_ = 0;
+    int64_t straight_ = 0;
+    int64_t diagonal_ = 0;
+};
+
+// 沿 x 方向逐像素移動到 to（不含起點）
+void walk_row(BoundaryWalker& walker, int from, int to, int y) {
+    int dx = to > from ? 1 : -1;
+    for (int x = from + dx; x != to + dx; x += dx) {
+        walker.move_to(x, y);
+    }
+}
+
+// 平行處理時每段的列數
+const int kBandRows = 64;
+
+// 一次檢查 8 個像素：全 0 或全 255 時整段跳過
+inline uint64_t load_word(const uchar* p) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+void encode_row(const uchar* row, int cols, int y, std::vector<Run>& out) {
+    int x = 0;
+    while (x < cols) {
+        while (x + 8 <= cols && load_word(row + x) == 0) {
+            x += 8;
+        }
+        while (x < cols && !row[x]) {
+            ++x;
+        }
+        if (x == cols) {
+            break;
+        }
+        int begin = x;
+        while (x + 8 <= cols && load_word(row + x) == ~0ULL) {
+            x += 8;
+        }
+        while (x < cols && row[x]) {
+            ++x;
+        }
+        out.push_back({ y, begin, x });
+    }
+}
+
+// 0^2 + 1^2 + ... + n^2
+double square_sum(int n) {
+    return (double)n * (n + 1) * (2.0 * n + 1) / 6.0;
+}
+
+} // namespace
+
+RunLengthMask RunLengthMask::from_mat(const cv::Mat& binary) {
+    RunLengthMask mask;
+    mask.assign(binary);
+    return mask;
+}
+
+void RunLengthMask::assign(const cv::Mat& binary) {
+    CV_Assert(binary.type() == CV_8UC1);
+    reset(binary.rows, binary.cols);
+
+    // 以固定列數分段平行編碼，再依序接起來；結果與逐列 append_row 相同
+    int bands = (binary.rows + kBandRows - 1) / kBandRows;
+    if ((int)band_runs_.size() < bands) {
+        band_runs_.resize(bands);
+    }
+    row_count_.assign(binary.rows, 0);
+
+    #pragma omp parallel for schedule(dynamic) if(parallel_within_frame(ParallelStage::RunLength, binary.rows * binary.cols))
+    for (int b = 0; b < bands; ++b) {
+        std::vector<Run>& band = band_runs_[b];
+        band.clear();
+        int y1 = std::min(binary.rows, (b + 1) * kBandRows);
+        for (int y = b * kBandRows; y < y1; ++y) {
+            size_t before = band.size();
+            encode_row(binary.ptr<uchar>(y), binary.cols, y, band);
+            row_count_[y] = (int)(band.size() - before);
+        }
+    }
+
+    size_t total = 0;
+    for (int b = 0; b < bands; ++b) {
+        total += band_runs_[b].size();
+    }
+    runs_.reserve(total);
+    for (int b = 0; b < bands; ++b) {
+        runs_.insert(runs_.end(), band_runs_[b].begin(), band_runs_[b].end());
+    }
+    for (int y = 0; y < binary.rows; ++y) {
+        row_start_.push_back(row_start_.back() + row_count_[y]);
+    }
+}
+
+void RunLengthMask::reset(int rows, int cols) {
+    rows_ = rows;
+    cols_ = cols;
+    runs_.clear();
+    row_start_.assign(1, 0);
+    row_start_.reserve(rows + 1);
+}
+
+void RunLengthMask::append_row(const uchar* mask_row) {
+    int y = (int)row_start_.size() - 1;
+    CV_Assert(y < rows_);
+    encode_row(mask_row, cols_, y, runs_);
+    row_start_.push_back((int)runs_.size());
+}
+
+void RunLengthMask::to_mat(cv::Mat& dst) const {
+    dst = cv::Mat::zeros(rows_, cols_, CV_8UC1);
+    for (const Run& run : runs_) {
+        std::fill(dst.ptr<uchar>(run.y) + run.begin, dst.ptr<uchar>(run.y) + run.end, (uchar)255);
+    }
+}
+
+int64_t RunLengthMask::area() const {
+    int64_t total = 0;
+    for (const Run& run : runs_) {
+        total += run.end - run.begin;
+    }
+    return total;
+}
+
+void label_runs(const RunLengthMask& mask, BlobLabels& labels) {
+    const std::vector<Run>& runs = mask.runs();
+    std::vector<int>& parent = labels.parent;
+    parent.resize(runs.size());
+    std::iota(parent.begin(), parent.end(), 0);
+
+    CV_Assert(mask.complete());
+
+    // 相鄰兩列的 run 在 x 上相接（含對角）即為 8 連通。
+    // 各段內的合併只會動到該段的 runs，可以平行；段與段的接縫最後再依序合併。
+    auto unite_rows = [&](int y) {
+        int i = mask.row_begin(y - 1), i_end = mask.row_begin(y);
+        int j = mask.row_begin(y), j_end = mask.row_begin(y + 1);
+        while (i < i_end && j < j_end) {
+            if (runs[i].begin <= runs[j].end && runs[j].begin <= runs[i].end) {
+                unite(parent, i, j);
+            }
+            if (runs[i].end <= runs[j].end) {
+                ++i;
+            } else {
+                ++j;
+            }
+        }
+    };
+
+    int bands = (mask.rows() + kBandRows - 1) / kBandRows;
+    #pragma omp parallel for schedule(dynamic) if(parallel_within_frame(ParallelStage::RunLength, mask.rows() * mask.cols()))
+    for (int b = 0; b < bands; ++b) {
+        int y1 = std::min(mask.rows(), (b + 1) * kBandRows);
+        for (int y = b * kBandRows + 1; y < y1; ++y) {
+            unite_rows(y);
+        }
+    }
+    for (int b = 1; b < bands; ++b) {
+        unite_rows(b * kBandRows);
+    }
+
+    labels.blobs.clear();
+    labels.run_label.assign(runs.size(), -1);
+    std::vector<int>& root_label = labels.root_label;
+    std::vector<int>& last_row = labels.last_row;
+    root_label.assign(runs.size(), -1);
+    last_row.clear();
+    for (size_t r = 0; r < runs.size(); ++r) {
+        int root = find_root(parent, (int)r);
+        if (root_label[root] < 0) {
+            root_label[root] = (int)labels.blobs.size();
+            labels.blobs.emplace_back();
+            labels.blobs.back().bbox = cv::Rect(runs[r].begin, runs[r].y, 0, 0);
+            last_row.push_back(-1);
+        }
+        int label = root_label[root];
+        labels.run_label[r] = label;
+
+        const Run& run = runs[r];
+        Blob& blob = labels.blobs[label];
+        double n = run.end - run.begin;
+        double sx = (run.begin + run.end - 1) * n * 0.5;
+        double sxx = square_sum(run.end - 1) - square_sum(run.begin - 1);
+        blob.area += run.end - run.begin;
+        blob.m10 += sx;
+        blob.m01 += run.y * n;
+        blob.m20 += sxx;
+        blob.m11 += run.y * sx;
+        blob.m02 += (double)run.y * run.y * n;
+        blob.run_count++;
+        if (last_row[label] == run.y) {
+            blob.single_run_rows = false;
+        }
+        last_row[label] = run.y;
+
+        int x0 = std::min(blob.bbox.x, run.begin);
+        int x1 = std::max(blob.bbox.x + blob.bbox.width, run.end);
+        blob.bbox.x = x0;
+        blob.bbox.width = x1 - x0;
+        blob.bbox.height = run.y + 1 - blob.bbox.y;
+    }
+
+    for (Blob& blob : labels.blobs) {
+        blob.touches_border = blob.bbox.x <= 0 || blob.bbox.y <= 0 ||
+                              blob.bbox.x + blob.bbox.width >= mask.cols() ||
+                              blob.bbox.y + blob.bbox.height >= mask.rows();
+    }
+}
+
+int largest_blob(const BlobLabels& labels) {
+    int largest = -1;
+    for (int i = 0; i < (int)labels.blobs.size(); ++i) {
+        if (largest < 0 || labels.blobs[i].area > labels.blobs[largest].area) {
+            largest = i;
+        }
+    }
+    return largest;
+}
+
+void render_blob(const RunLengthMask& mask, const BlobLabels& labels, int blob, const cv::Rect& box, cv::Mat& dst) {
+    CV_Assert(blob >= 0 && blob < (int)labels.blobs.size());
+    dst.create(box.size(), CV_8UC1);
+    dst.setTo(0);
+
+    const std::vector<Run>& runs = mask.runs();
+    int y0 = std::max(box.y, 0), y1 = std::min(box.y + box.height, mask.rows());
+    for (int y = y0; y < y1; ++y) {
+        uchar* row = dst.ptr<uchar>(y - box.y);
+        for (int r = mask.row_begin(y); r < mask.row_begin(y + 1); ++r) {
+            if (labels.run_label[r] != blob) {
+                continue;
+            }
+            int x0 = std::max(runs[r].begin, box.x), x1 = std::min(runs[r].end, box.x + box.width);
+            if (x1 > x0) {
+                std::memset(row + (x0 - box.x), 255, x1 - x0);
+            }
+        }
+    }
+}
+
+ContourMetrics measure_blob(const RunLengthMask& mask, const BlobLabels& labels, int blob,
+                            const MetricsOptions& options, PointArena* arena) {
+    CV_Assert(blob >= 0 && blob < (int)labels.blobs.size());
+    const cv::Rect& bbox = labels.blobs[blob].bbox;
+    const std::vector<Run>& runs = mask.runs();
+
+    BlobScratch& scratch = tls_blob;
+    if (!labels.blobs[blob].single_run_rows) {
+        // 洞與水平凹口無法只用每列兩端描述，只追蹤這個 blob 的外框（與 findContours 相同）
+        cv::Rect box(bbox.x - 1, bbox.y - 1, bbox.width + 2, bbox.height + 2);
+        if (scratch.canvas.rows < box.height || scratch.canvas.cols < box.width) {
+            scratch.canvas.create(std::max(scratch.canvas.rows, box.height), std::max(scratch.canvas.cols, box.width),
+                                  CV_8UC1);
+        }
+        cv::Mat canvas = scratch.canvas(cv::Rect(0, 0, box.width, box.height));
+        render_blob(mask, labels, blob, box, canvas);
+        trace_external_contours(canvas, scratch.trace, true, box.tl(), &scratch.marks);
+        return measure_traced_contour(scratch.trace.largest, options, arena);
+    }
+
+    // 每列的最左、最右像素
+    std::vector<int>& left = scratch.left;
+    std::vector<int>& right = scratch.right;
+    left.assign(bbox.height, INT_MAX);
+    right.assign(bbox.height, -1);
+    for (int y = bbox.y; y < bbox.y + bbox.height; ++y) {
+        for (int r = mask.row_begin(y); r < mask.row_begin(y + 1); ++r) {
+            if (labels.run_label[r] == blob) {
+                left[y - bbox.y] = std::min(left[y - bbox.y], runs[r].begin);
+                right[y - bbox.y] = std::max(right[y - bbox.y], runs[r].end - 1);
+            }
+        }
+    }
+
+    // 與 findContours 外框追蹤相同的順序：上緣向右，右側向下，下緣向左，左側向上。
+    // 相鄰列端點相差超過 1 時，往外走先斜向再水平，往內走先水平再斜向。
+    std::vector<cv::Point>& contour = scratch.contour;
+    contour.clear();
+    BoundaryWalker walker(options.keep_points ? &contour : nullptr);
+    int top = 0, bottom = bbox.height - 1;
+    walker.move_to(left[top], bbox.y);
+    walk_row(walker, left[top], right[top], bbox.y);
+    for (int i = top; i < bottom; ++i) {
+        int y = bbox.y + i;
+        int a = right[i], b = right[i + 1];
+        if (b > a) {
+            walker.move_to(a + 1, y + 1);
+            walk_row(walker, a + 1, b, y + 1);
+        } else if (b < a) {
+            walk_row(walker, a, b + 1, y);
+            walker.move_to(b, y + 1);
+        } else {
+            walker.move_to(b, y + 1);
+        }
+    }
+    if (bottom > top || right[bottom] > left[bottom]) {
+        walk_row(walker, right[bottom], left[bottom], bbox.y + bottom);
+    }
+    for (int i = bottom; i > top; --i) {
+        int y = bbox.y + i;
+        int a = left[i], b = left[i - 1];
+        if (b < a) {
+            walker.move_to(a - 1, y - 1);
+            walk_row(walker, a - 1, b, y - 1);
+        } else if (b > a) {
+            walk_row(walker, a, b - 1, y);
+            walker.move_to(b, y - 1);
+        } else {
+            walker.move_to(b, y - 1);
+        }
+    }
+    // 回到起點的那一步由 close() 計入
+    if (options.keep_points && contour.size() > 1 && contour.back() == contour.front()) {
+        contour.pop_back();
+    }
+    walker.close();
+
+    // 凸包只需要每列的兩個端點
+    std::vector<cv::Point>& endpoints = scratch.endpoints;
+    endpoints.clear();
+    endpoints.reserve(2 * bbox.height);
+    for (int i = 0; i < bbox.height; ++i) {
+        endpoints.emplace_back(left[i], bbox.y + i);
+        if (right[i] != left[i]) {
+            endpoints.emplace_back(right[i], bbox.y + i);
+        }
+    }
+    std::vector<cv::Point>& hull = scratch.hull;
+    HullMetrics hull_metrics = contour_hull(endpoints, options.keep_points ? &hull : nullptr);
+
+    ContourMetrics results = make_contour_metrics(walker.area(), walker.perimeter(),
+                                                  hull_metrics.area, hull_metrics.perimeter, options);
+    if (results.ok() && options.keep_points) {
+        store_points(results, PointSpan(contour.data(), contour.size()), PointSpan(hull.data(), hull.size()), arena);
+    }
+    return results;
+}
+
+ContourMetrics measure_largest_blob(const RunLengthMask& mask, const MetricsOptions& options,
+                                    bool require_single_complete) {
+    BlobLabels labels;
+    return measure_largest_blob(mask, labels, options, require_single_complete);
+}
+
+ContourMetrics measure_largest_blob(const RunLengthMask& mask, BlobLabels& labels, const MetricsOptions& options,
+                                    bool require_single_complete, PointArena* arena) {
+    label_runs(mask, labels);
+    if (labels.blobs.empty()) {
+        return ContourMetrics();
+    }
+
+    int largest = largest_blob(labels);
+    if (require_single_complete) {
+        ContourMetrics rejected;
+        if (labels.blobs.size() > 1) {
+            rejected.status = FrameStatus::MultipleContours;
+            return rejected;
+        }
+        if (labels.blobs[largest].touches_border) {
+            rejected.status = FrameStatus::IncompleteContour;
+            return rejected;
+        }
+    }
+
+    return measure_blob(mask, labels, largest, options, arena);
+}
+
+} // namespace droplet
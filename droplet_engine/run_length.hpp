@@ -0,0 +1,98 @@
+#pragma once
+
+#include "droplet_engine/contour_metrics.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace droplet {
+
+// 一列中連續的前景像素 [begin, end)
+struct Run {
+    int y;
+    int begin;
+    int end;
+};
+
+// 二值影像的 run-length 表示；runs 依列、再依 x 排序
+class RunLengthMask {
+public:
+    RunLengthMask() = default;
+    RunLengthMask(int rows, int cols) { reset(rows, cols); }
+
+    // 分段平行編碼（OpenMP）
+    static RunLengthMask from_mat(const cv::Mat& binary);
+    // 同 from_mat，但沿用既有的 vector 容量；每張影像重複使用同一個物件時不再配置
+    void assign(const cv::Mat& binary);
+    void to_mat(cv::Mat& dst) const;
+
+    void reset(int rows, int cols);
+    // 依列順序加入一列（非 0 為前景）；fused_segment 在二值化的同一次掃描中呼叫
+    void append_row(const uchar* mask_row);
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    bool complete() const { return (int)row_start_.size() == rows_ + 1; }
+    const std::vector<Run>& runs() const { return runs_; }
+    // 第 y 列的 runs 為 [row_begin(y), row_begin(y + 1))
+    int row_begin(int y) const { return row_start_[y]; }
+
+    int64_t area() const;
+
+private:
+    int rows_ = 0;
+    int cols_ = 0;
+    std::vector<Run> runs_;
+    std::vector<int> row_start_;
+    // assign 的分段暫存
+    std::vector<std::vector<Run>> band_runs_;
+    std::vector<int> row_count_;
+};
+
+// 8 連通的 run 連通區塊
+struct Blob {
+    int64_t area = 0;           // 像素數
+    cv::Rect bbox;
+    // 像素的空間矩
+    double m10 = 0, m01 = 0, m20 = 0, m11 = 0, m02 = 0;
+    int run_count = 0;
+    // 每列只有一段 run；此時輪廓量測與 findContours 逐位元相同
+    bool single_run_rows = true;
+    // 外框碰到影像邊界（等同外輪廓 !is_contour_complete）
+    bool touches_border = false;
+};
+
+struct BlobLabels {
+    std::vector<Blob> blobs;
+    std::vector<int> run_label;     // 每個 run 所屬的 blob
+
+    // label_runs 的暫存；重複使用同一個 BlobLabels 時不再配置
+    std::vector<int> parent;
+    std::vector<int> root_label;
+    std::vector<int> last_row;
+};
+
+// 一次掃描 runs 得到每個 blob 的面積、外框、矩與是否碰到邊界；分段平行合併
+void label_runs(const RunLengthMask& mask, BlobLabels& labels);
+
+// 把單一 blob 畫進 box 範圍的 0 / 255 影像（box 為影像座標）
+void render_blob(const RunLengthMask& mask, const BlobLabels& labels, int blob, const cv::Rect& box, cv::Mat& dst);
+
+// 像素數最多的 blob，沒有 blob 時為 -1
+int largest_blob(const BlobLabels& labels);
+
+// 結果與 findContours(RETR_EXTERNAL, CHAIN_APPROX_NONE) + calculate_contour_metrics 相同（run_length_test 檢查）。
+// single_run_rows 時沿每列的最左、最右像素走一次外輪廓計算面積（鞋帶公式）、周長與凸包；
+// 列中有多段 run（洞、水平凹口）時只把這個 blob 畫進外框大小的影像再追蹤。
+ContourMetrics measure_blob(const RunLengthMask& mask, const BlobLabels& labels, int blob,
+                            const MetricsOptions& options = MetricsOptions(), PointArena* arena = nullptr);
+
+// 取像素數最多的 blob 量測；require_single_complete 時只接受單一且未碰到邊界的 blob
+ContourMetrics measure_largest_blob(const RunLengthMask& mask, const MetricsOptions& options = MetricsOptions(),
+                                    bool require_single_complete = false);
+// 同上，標記結果寫入呼叫端的 labels，點存進 arena
+ContourMetrics measure_largest_blob(const RunLengthMask& mask, BlobLabels& labels, const MetricsOptions& options,
+                                    bool require_single_complete, PointArena* arena = nullptr);
+
+} // namespace droplet
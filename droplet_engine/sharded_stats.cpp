@@ -0,0 +1,165 @@
+#include "droplet_engine/sharded_stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace droplet {
+
+int TimeStats::bin_of(double time) {
+    if (!(time >= 1)) {
+        return 0;
+    }
+    int exponent;
+    std::frexp(time, &exponent);    // time 在 [2^(e-1), 2^e)
+    return std::min(exponent, kBins - 1);
+}
+
+void TimeStats::add(double time, int64_t frame) {
+    if (count == 0 || time < min) {
+        min = time;
+    }
+    if (count == 0 || time > max) {
+        max = time;
+        argmax = frame;
+    }
+    ++count;
+    sum += time;
+    ++histogram[bin_of(time)];
+}
+
+void TimeStats::merge(const TimeStats& other) {
+    if (other.count == 0) {
+        return;
+    }
+    if (count == 0 || other.min < min) {
+        min = other.min;
+    }
+    if (count == 0 || other.max > max) {
+        max = other.max;
+        argmax = other.argmax;
+    }
+    count += other.count;
+    sum += other.sum;
+    for (int b = 0; b < kBins; ++b) {
+        histogram[b] += other.histogram[b];
+    }
+}
+
+double TimeStats::quantile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t target = (uint64_t)std::ceil(std::clamp(q, 0.0, 1.0) * count);
+    uint64_t seen = 0;
+    for (int b = 0; b < kBins; ++b) {
+        seen += histogram[b];
+        if (seen >= std::max<uint64_t>(target, 1)) {
+            return std::min(std::ldexp(1.0, b), max);
+        }
+    }
+    return max;
+}
+
+ShardedStats::ShardedStats(int shards)
+    : shards_count_(std::max(1, shards)), shards_(new Shard[shards_count_]) {
+}
+
+void ShardedStats::add(int shard, double time, int64_t frame) {
+    Shard& s = shards_[shard];
+    // 只有擁有者會寫入：先讀目前值再 store，不需要 fetch_add
+    uint64_t sequence = s.sequence.load(std::memory_order_relaxed);
+    s.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint64_t count = s.count.load(std::memory_order_relaxed);
+    if (count == 0 || time < s.min.load(std::memory_order_relaxed)) {
+        s.min.store(time, std::memory_order_relaxed);
+    }
+    if (count == 0 || time > s.max.load(std::memory_order_relaxed)) {
+        s.max.store(time, std::memory_order_relaxed);
+        s.argmax.store(frame, std::memory_order_relaxed);
+    }
+    s.count.store(count + 1, std::memory_order_relaxed);
+    s.sum.store(s.sum.load(std::memory_order_relaxed) + time, std::memory_order_relaxed);
+    std::atomic<uint64_t>& bin = s.histogram[TimeStats::bin_of(time)];
+    bin.store(bin.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    s.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+TimeStats ShardedStats::shard_snapshot(int shard) const {
+    const Shard& s = shards_[shard];
+    TimeStats stats;
+    for (;;) {
+        uint64_t before = s.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        stats.count = s.count.load(std::memory_order_relaxed);
+        stats.sum = s.sum.load(std::memory_order_relaxed);
+        stats.min = s.min.load(std::memory_order_relaxed);
+        stats.max = s.max.load(std::memory_order_relaxed);
+        stats.argmax = s.argmax.load(std::memory_order_relaxed);
+        for (int b = 0; b < TimeStats::kBins; ++b) {
+            stats.histogram[b] = s.histogram[b].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.sequence.load(std::memory_order_relaxed) == before) {
+            return stats;
+        }
+    }
+}
+
+TimeStats ShardedStats::snapshot() const {
+    TimeStats total;
+    for (int i = 0; i < shards_count_; ++i) {
+        total.merge(shard_snapshot(i));
+    }
+    return total;
+}
+
+void ShardedStats::reset() {
+    for (int i = 0; i < shards_count_; ++i) {
+        Shard& s = shards_[i];
+        s.count.store(0, std::memory_order_relaxed);
+        s.sum.store(0, std::memory_order_relaxed);
+        s.min.store(0, std::memory_order_relaxed);
+        s.max.store(0, std::memory_order_relaxed);
+        s.argmax.store(-1, std::memory_order_relaxed);
+        for (std::atomic<uint64_t>& bin : s.histogram) {
+            bin.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+StatsReporter::StatsReporter(const ShardedStats& stats, std::chrono::milliseconds interval, Report report)
+    : stats_(stats), report_(std::move(report)) {
+    thread_ = std::thread([this, interval]() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!wake_.wait_for(lock, interval, [this]() { return stop_; })) {
+            lock.unlock();
+            report_(stats_.snapshot(), false);
+            lock.lock();
+        }
+    });
+}
+
+StatsReporter::~StatsReporter() {
+    stop();
+}
+
+void StatsReporter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stop_) {
+            return;
+        }
+        stop_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+    report_(stats_.snapshot(), true);
+}
+
+} // namespace droplet
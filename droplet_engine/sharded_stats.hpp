@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace droplet {
+
+// 處理時間（微秒）的統計值；合併後的快照
+struct TimeStats {
+    // bin 0 為 [0, 1) us，bin b >= 1 為 [2^(b-1), 2^b) us；最後一個 bin 收容更大的值
+    static const int kBins = 32;
+
+    uint64_t count = 0;
+    double sum = 0;
+    double min = 0;
+    double max = 0;
+    int64_t argmax = -1;        // 最大值的影像索引
+    uint64_t histogram[kBins] = {};
+
+    static int bin_of(double time);
+
+    void add(double time, int64_t frame);
+    void merge(const TimeStats& other);
+
+    double average() const { return count > 0 ? sum / count : 0; }
+    // 由直方圖估計的分位數（所在 bin 的上界，不超過 max）
+    double quantile(double q) const;
+};
+
+// 每個 worker 一個 shard，各佔獨立的 cache line。熱路徑上 add 只由 shard 的擁有者呼叫，
+// 只有 relaxed store，沒有鎖與 read-modify-write；snapshot 可在任何時候由任何執行緒呼叫，
+// 以 seqlock 取得一致的快照，讀取端重試、寫入端不等待。核心數增加時每筆的統計成本不變。
+class ShardedStats {
+public:
+    explicit ShardedStats(int shards);
+
+    ShardedStats(const ShardedStats&) = delete;
+    ShardedStats& operator=(const ShardedStats&) = delete;
+
+    int size() const { return shards_count_; }
+
+    void add(int shard, double time, int64_t frame);
+
+    TimeStats shard_snapshot(int shard) const;
+    TimeStats snapshot() const;
+
+    // 沒有寫入者時才可呼叫
+    void reset();
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> sequence{ 0 };
+        std::atomic<uint64_t> count{ 0 };
+        std::atomic<double> sum{ 0 };
+        std::atomic<double> min{ 0 };
+        std::atomic<double> max{ 0 };
+        std::atomic<int64_t> argmax{ -1 };
+        std::atomic<uint64_t> histogram[TimeStats::kBins] = {};
+    };
+
+    int shards_count_;
+    std::unique_ptr<Shard[]> shards_;
+};
+
+// 背景執行緒每隔 interval 合併一次 shard 並呼叫 report(stats, false)；stop() 或解構時
+// 再回報一次最終結果（final = true）。回報只讀取 shard，不影響 worker。
+class StatsReporter {
+public:
+    using Report = std::function<void(const TimeStats&, bool)>;
+
+    StatsReporter(const ShardedStats& stats, std::chrono::milliseconds interval, Report report);
+    ~StatsReporter();
+
+    StatsReporter(const StatsReporter&) = delete;
+    StatsReporter& operator=(const StatsReporter&) = delete;
+
+    void stop();
+
+private:
+    const ShardedStats& stats_;
+    Report report_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+} // namespace droplet
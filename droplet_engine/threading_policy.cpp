@@ -0,0 +1,131 @@
+#include "droplet_engine/threading_policy.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/parallel/parallel_backend.hpp>
+#include <atomic>
+#include <memory>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace droplet {
+
+namespace {
+
+// 熱路徑只讀這些 atomic，不需要鎖
+std::atomic<int> g_stages[kParallelStageCount] = {
+    { (int)Parallelism::Auto }, { (int)Parallelism::Auto }, { (int)Parallelism::Auto }, { (int)Parallelism::Auto }
+};
+std::atomic<int> g_min_parallel_pixels{ ThreadingPolicy().min_parallel_pixels };
+
+thread_local int tls_frame_scopes = 0;
+
+Parallelism stage_mode(ParallelStage stage) {
+    return (Parallelism)g_stages[(int)stage].load(std::memory_order_relaxed);
+}
+
+class PoolBackend : public cv::parallel::ParallelForAPI {
+public:
+    explicit PoolBackend(WorkerPool& pool) : pool_(pool), threads_(pool.size()) {}
+
+    void parallel_for(int tasks, FN_parallel_for_body_cb_t body, void* data) override {
+        // OpenCV 的 stripe 沒有影像大小可看，Auto 只看是否已在跨影像的平行區段中
+        if (tasks <= 1 || threads_.load(std::memory_order_relaxed) <= 1 || in_frame_parallel_region() ||
+            stage_mode(ParallelStage::OpenCV) == Parallelism::AcrossFrames) {
+            body(0, tasks, data);
+            return;
+        }
+        pool_.run(tasks, [body, data](size_t i, int) { body((int)i, (int)i + 1, data); });
+    }
+
+    int getThreadNum() const override { return std::max(0, WorkerPool::current_worker()); }
+    int getNumThreads() const override { return threads_.load(std::memory_order_relaxed); }
+
+    // pool 的大小固定；這裡只能限制為 1（依序）或恢復使用整個 pool
+    int setNumThreads(int threads) override {
+        int previous = threads_.load(std::memory_order_relaxed);
+        threads_.store(threads <= 0 ? pool_.size() : std::min(threads, pool_.size()), std::memory_order_relaxed);
+        return previous;
+    }
+
+    const char* getName() const override { return "droplet"; }
+
+private:
+    WorkerPool& pool_;
+    std::atomic<int> threads_;
+};
+
+} // namespace
+
+ThreadingPolicy ThreadingPolicy::across_frames() {
+    ThreadingPolicy policy;
+    for (Parallelism& stage : policy.stages) {
+        stage = Parallelism::AcrossFrames;
+    }
+    return policy;
+}
+
+ThreadingPolicy ThreadingPolicy::within_frame() {
+    ThreadingPolicy policy;
+    for (Parallelism& stage : policy.stages) {
+        stage = Parallelism::WithinFrame;
+    }
+    return policy;
+}
+
+void set_threading_policy(const ThreadingPolicy& policy) {
+    for (int i = 0; i < kParallelStageCount; ++i) {
+        g_stages[i].store((int)policy.stages[i], std::memory_order_relaxed);
+    }
+    g_min_parallel_pixels.store(policy.min_parallel_pixels, std::memory_order_relaxed);
+}
+
+ThreadingPolicy threading_policy() {
+    ThreadingPolicy policy;
+    for (int i = 0; i < kParallelStageCount; ++i) {
+        policy.stages[i] = (Parallelism)g_stages[i].load(std::memory_order_relaxed);
+    }
+    policy.min_parallel_pixels = g_min_parallel_pixels.load(std::memory_order_relaxed);
+    return policy;
+}
+
+bool in_frame_parallel_region() {
+    if (tls_frame_scopes > 0 || WorkerPool::current_worker() >= 0) {
+        return true;
+    }
+#ifdef _OPENMP
+    return omp_in_parallel() != 0;
+#else
+    return false;
+#endif
+}
+
+bool parallel_within_frame(ParallelStage stage, int pixels) {
+    if (in_frame_parallel_region()) {
+        return false;
+    }
+    switch (stage_mode(stage)) {
+    case Parallelism::AcrossFrames:
+        return false;
+    case Parallelism::WithinFrame:
+        return true;
+    default:
+        return pixels >= g_min_parallel_pixels.load(std::memory_order_relaxed);
+    }
+}
+
+FrameParallelScope::FrameParallelScope() {
+    ++tls_frame_scopes;
+}
+
+FrameParallelScope::~FrameParallelScope() {
+    --tls_frame_scopes;
+}
+
+void install_opencv_backend(WorkerPool& pool) {
+    // 不把 OpenCV 目前的執行緒數套到 pool 上
+    cv::parallel::setParallelForBackend(std::make_shared<PoolBackend>(pool), false);
+}
+
+} // namespace droplet
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "droplet_engine/worker_pool.hpp"
+
+namespace droplet {
+
+// 平行化放在哪一層：同一時間只有一層使用所有核心，避免「核心數 x 核心數」個執行緒
+enum class Parallelism {
+    AcrossFrames,   // 每個執行緒處理一整張影像，影像內部不再平行
+    WithinFrame,    // 一次一張影像，影像內部的迴圈與 OpenCV 函式使用所有核心
+    Auto            // 在跨影像的平行區段內不平行；否則影像夠大才在內部平行
+};
+
+// 影像內部可以平行的階段
+enum class ParallelStage {
+    Background,     // BackgroundModel::update
+    Morphology,     // parallel_erode / parallel_dilate、BitMask
+    RunLength,      // run-length 編碼與標記
+    OpenCV          // 經由 parallel_for_ 的 OpenCV 函式（GaussianBlur、threshold、Canny 等）
+};
+
+const int kParallelStageCount = 4;
+
+struct ThreadingPolicy {
+    Parallelism stages[kParallelStageCount] = {
+        Parallelism::Auto, Parallelism::Auto, Parallelism::Auto, Parallelism::Auto
+    };
+    // Auto 時影像內部平行的最小像素數；小影像分給多個執行緒的成本比處理本身還高
+    int min_parallel_pixels = 512 * 512;
+
+    Parallelism& operator[](ParallelStage stage) { return stages[(int)stage]; }
+    Parallelism operator[](ParallelStage stage) const { return stages[(int)stage]; }
+
+    static ThreadingPolicy across_frames();
+    static ThreadingPolicy within_frame();
+};
+
+// 全域設定；可在任何時候更換，處理中的影像在下一個階段開始時套用
+void set_threading_policy(const ThreadingPolicy& policy);
+ThreadingPolicy threading_policy();
+
+// 目前執行緒是否已在跨影像的平行區段中：WorkerPool 的 worker、OpenMP 平行區段，
+// 或以 FrameParallelScope 標記的執行緒（TBB、自建的 worker 執行緒）
+bool in_frame_parallel_region();
+
+// 這個階段對 pixels 大小的影像是否在內部平行；在跨影像的平行區段中永遠為 false。
+// 函式庫內的迴圈以 `#pragma omp parallel for if(parallel_within_frame(...))` 使用
+bool parallel_within_frame(ParallelStage stage, int pixels);
+
+// 非 WorkerPool、非 OpenMP 的跨影像 worker 在處理影像期間建立一個，影像內部因而不再平行。
+// 可巢狀；只影響目前執行緒
+class FrameParallelScope {
+public:
+    FrameParallelScope();
+    ~FrameParallelScope();
+
+    FrameParallelScope(const FrameParallelScope&) = delete;
+    FrameParallelScope& operator=(const FrameParallelScope&) = delete;
+};
+
+// 以 pool 取代 OpenCV 的 parallel_for_ 後端。OpenCV 函式在跨影像的平行區段中直接在目前執行緒
+// 依序執行（不再另開執行緒，也不會在 pool 的 worker 中重入 pool）；其餘情況依 ParallelStage::OpenCV
+// 的設定決定分給 pool 或依序執行。整個程式呼叫一次即可，pool 必須比之後所有 OpenCV 呼叫活得久
+void install_opencv_backend(WorkerPool& pool = WorkerPool::shared());
+
+} // namespace droplet
@@ -0,0 +1,203 @@
+#include "droplet_engine/worker_pool.hpp"
+
+#include <algorithm>
+
+namespace droplet {
+
+namespace {
+
+uint64_t pack(uint32_t begin, uint32_t end) {
+    return ((uint64_t)end << 32) | begin;
+}
+
+uint32_t range_begin(uint64_t bounds) {
+    return (uint32_t)bounds;
+}
+
+uint32_t range_end(uint64_t bounds) {
+    return (uint32_t)(bounds >> 32);
+}
+
+// 打包的區間最多 2^32 - 1 張，更大的批次分段執行
+const size_t kMaxBatch = UINT32_MAX;
+
+thread_local int tls_worker = -1;
+
+} // namespace
+
+WorkerPool::WorkerPool(int workers) {
+    if (workers <= 0) {
+        workers = (int)std::max(1u, std::thread::hardware_concurrency());
+    }
+    ranges_.reset(new StealRange[workers]);
+    threads_.reserve(workers);
+    for (int w = 0; w < workers; ++w) {
+        threads_.emplace_back([this, w]() { worker_loop(w); });
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_.notify_all();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+int WorkerPool::current_worker() {
+    return tls_worker;
+}
+
+WorkerPool& WorkerPool::shared() {
+    static WorkerPool pool;
+    return pool;
+}
+
+void WorkerPool::run(size_t count, const std::function<void(size_t, int)>& task) {
+    for (size_t base = 0; base < count; base += kMaxBatch) {
+        size_t batch = std::min(count - base, kMaxBatch);
+        if (base == 0) {
+            dispatch(batch, false, task);
+        } else {
+            dispatch(batch, false, [&task, base](size_t i, int worker) { task(base + i, worker); });
+        }
+    }
+}
+
+void WorkerPool::run_on_each(const std::function<void(int)>& task) {
+    dispatch(threads_.size(), true, [&task](size_t, int worker) { task(worker); });
+}
+
+void WorkerPool::dispatch(size_t count, bool each, const std::function<void(size_t, int)>& task) {
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    std::unique_lock<std::mutex> lock(mutex_);
+    task_ = &task;
+    each_ = each;
+    error_ = nullptr;
+    if (!each) {
+        // 每個 worker 一段連續區間；工作執行緒在 generation_ 改變（互斥鎖之下）之後才會讀取
+        size_t workers = threads_.size();
+        for (size_t w = 0; w < workers; ++w) {
+            ranges_[w].bounds.store(pack((uint32_t)(count * w / workers), (uint32_t)(count * (w + 1) / workers)),
+                                    std::memory_order_relaxed);
+        }
+        steals_.store(0, std::memory_order_relaxed);
+    }
+    active_ = (int)threads_.size();
+    ++generation_;
+    start_.notify_all();
+
+    done_.wait(lock, [this]() { return active_ == 0; });
+    task_ = nullptr;
+    if (error_) {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void WorkerPool::worker_loop(int worker) {
+    tls_worker = worker;
+    uint64_t seen = 0;
+    for (;;) {
+        const std::function<void(size_t, int)>* task;
+        bool each;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+            task = task_;
+            each = each_;
+        }
+
+        std::exception_ptr error;
+        try {
+            if (each) {
+                (*task)(worker, worker);
+            } else {
+                run_range(worker, *task);
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error && !error_) {
+            error_ = error;
+        }
+        if (--active_ == 0) {
+            done_.notify_all();
+        }
+    }
+}
+
+void WorkerPool::run_range(int worker, const std::function<void(size_t, int)>& task) {
+    uint32_t begin, end;
+    do {
+        while (take(worker, begin, end)) {
+            for (uint32_t i = begin; i < end; ++i) {
+                task(i, worker);
+            }
+        }
+    } while (steal(worker));
+}
+
+bool WorkerPool::take(int worker, uint32_t& begin, uint32_t& end) {
+    std::atomic<uint64_t>& bounds = ranges_[worker].bounds;
+    uint64_t current = bounds.load(std::memory_order_acquire);
+    for (;;) {
+        uint32_t first = range_begin(current), last = range_end(current);
+        if (first >= last) {
+            return false;
+        }
+        uint32_t grain = std::max<uint32_t>(1, (last - first) / kGrainDivisor);
+        if (bounds.compare_exchange_weak(current, pack(first + grain, last), std::memory_order_acq_rel)) {
+            begin = first;
+            end = first + grain;
+            return true;
+        }
+    }
+}
+
+bool WorkerPool::steal(int worker) {
+    int workers = (int)threads_.size();
+    for (;;) {
+        // 找剩餘最多的區間；全部為空時這一批已沒有可分配的工作
+        int victim = -1;
+        uint64_t victim_bounds = 0;
+        uint32_t most = 0;
+        for (int w = 0; w < workers; ++w) {
+            if (w == worker) {
+                continue;
+            }
+            uint64_t current = ranges_[w].bounds.load(std::memory_order_acquire);
+            uint32_t remaining = range_end(current) > range_begin(current) ? range_end(current) - range_begin(current) : 0;
+            if (remaining > most) {
+                most = remaining;
+                victim = w;
+                victim_bounds = current;
+            }
+        }
+        if (victim < 0) {
+            return false;
+        }
+
+        // 偷後半段（只剩一張時整張拿走）；CAS 失敗表示區間已變動，重新挑選
+        uint32_t first = range_begin(victim_bounds), last = range_end(victim_bounds);
+        uint32_t middle = first + (last - first) / 2;
+        if (ranges_[victim].bounds.compare_exchange_strong(victim_bounds, pack(first, middle), std::memory_order_acq_rel)) {
+            // 自己的區間已空，其他竊取者不會在這之前對它 CAS 成功
+            ranges_[worker].bounds.store(pack(middle, last), std::memory_order_release);
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+}
+
+} // namespace droplet
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace droplet {
+
+// 整個程式共用、長駐的執行緒池：執行緒只在建構時建立一次，之後每一批工作
+// 只是喚醒既有的執行緒，重複實驗量到的是穩態處理量，而非建立執行緒 / arena 的成本。
+// run 不可在池內的工作中再次呼叫（同一時間只跑一批）。
+class WorkerPool {
+public:
+    // workers <= 0 時使用 hardware_concurrency()
+    explicit WorkerPool(int workers = 0);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // 第一次呼叫時建立
+    static WorkerPool& shared();
+
+    int size() const { return (int)threads_.size(); }
+
+    // task(i, worker) 對 i = 0 .. count-1 各執行一次；全部完成後返回。
+    // 索引先平均切成每個 worker 一段連續區間，worker 從自己區間的前端每次取剩餘量的 1/kGrainDivisor
+    // （至少 1 張），區間越短粒度越小；自己的區間取完後，從剩餘最多的 worker 的後端偷走一半。
+    // 少數特別慢的影像（大液滴、多個 blob）不會讓某個執行緒最後獨自收尾，總時間接近總工作量 / 核心數。
+    // 不保證依索引順序執行，需要依序輸出時不可搭配視窗有限的 OrderedSink。
+    // 工作丟出的第一個例外在這裡重新丟出
+    void run(size_t count, const std::function<void(size_t, int)>& task);
+
+    // 每個 worker 在自己的執行緒上恰好執行一次 task(worker)（預熱 per-worker 狀態）
+    void run_on_each(const std::function<void(int)>& task);
+
+    // 目前執行緒在所屬池中的 worker 編號；不是任何 WorkerPool 的執行緒時為 -1
+    static int current_worker();
+
+    // 目前這一批被偷走的區間數（觀察負載不均用）
+    uint64_t steals() const { return steals_.load(std::memory_order_relaxed); }
+
+    static const uint32_t kGrainDivisor = 8;
+
+private:
+    // [begin, end) 以兩個 32 位元值打包成一個 atomic，擁有者取前端、竊取者取後端都只需一次 CAS
+    struct alignas(64) StealRange {
+        std::atomic<uint64_t> bounds{ 0 };
+    };
+
+    void dispatch(size_t count, bool each, const std::function<void(size_t, int)>& task);
+    void worker_loop(int worker);
+    void run_range(int worker, const std::function<void(size_t, int)>& task);
+    bool take(int worker, uint32_t& begin, uint32_t& end);
+    bool steal(int worker);
+
+    std::vector<std::thread> threads_;
+    std::mutex run_mutex_;          // 一次一批
+
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    const std::function<void(size_t, int)>* task_ = nullptr;
+    bool each_ = false;
+    uint64_t generation_ = 0;
+    int active_ = 0;
+    bool stop_ = false;
+    std::exception_ptr error_;
+
+    std::unique_ptr<StealRange[]> ranges_;
+    std::atomic<uint64_t> steals_{ 0 };
+};
+
+// 每個 worker 一份的狀態（scratch Mat、統計等），各佔獨立的 cache line，跨批次保留
+template <typename T>
+class WorkerLocal {
+public:
+    explicit WorkerLocal(int workers) : slots_(workers) {}
+    explicit WorkerLocal(const WorkerPool& pool) : slots_(pool.size()) {}
+
+    T& operator[](int worker) { return slots_[worker].value; }
+    const T& operator[](int worker) const { return slots_[worker].value; }
+    int size() const { return (int)slots_.size(); }
+
+    template <typename Fn>
+    void for_each(Fn fn) {
+        for (Slot& slot : slots_) {
+            fn(slot.value);
+        }
+    }
+
+private:
+    struct alignas(64) Slot {
+        T value;
+    };
+    std::vector<Slot> slots_;
+};
+
+} // namespace droplet
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "droplet_engine/sharded_stats.hpp"
+#include "droplet_engine/threading_policy.hpp"
+
+#include <tbb/concurrent_queue.h>
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <utility>
+
+namespace droplet {
+
+// N 個 worker 在專屬的 task_arena 中從同一個佇列取工作，佇列空時阻塞等待（不 yield 空轉）。
+// handler(item, worker) 回傳該筆的處理時間，記在該 worker 自己的 stats shard，argmax 為 push 的順序。
+// 工作執行緒不足時（例如單核心）剩下的 worker 在 wait() 中由呼叫端執行，因此 push 不阻塞。
+template <typename Item>
+class WorkerStage {
+public:
+    using Handler = std::function<double(Item&, int)>;
+
+    WorkerStage(int workers, Handler handler)
+        : workers_(std::max(1, workers)), handler_(std::move(handler)),
+          arena_(workers_ + 1, 1), stats_(workers_) {
+        // 多保留一個 master 位置給呼叫端；workers_ 個工作執行緒各跑一個 worker
+        arena_.execute([this]() {
+            for (int w = 0; w < workers_; ++w) {
+                group_.run([this, w]() { run_worker(w); });
+            }
+        });
+    }
+
+    ~WorkerStage() { wait(); }
+
+    WorkerStage(const WorkerStage&) = delete;
+    WorkerStage& operator=(const WorkerStage&) = delete;
+
+    // 回傳這筆的索引（push 的順序，從 0 開始），即統計中的 argmax；push 只由單一執行緒呼叫
+    size_t push(Item item) {
+        size_t index = pushed_++;
+        queue_.push(Task(std::in_place, index, std::move(item)));
+        return index;
+    }
+
+    // 不再有新工作：每個 worker 收到一個結束標記，處理完前面的工作後離開
+    void close() {
+        if (closed_) {
+            return;
+        }
+        closed_ = true;
+        for (int w = 0; w < workers_; ++w) {
+            queue_.push(std::nullopt);
+        }
+    }
+
+    void wait() {
+        close();
+        if (!joined_) {
+            arena_.execute([this]() { group_.wait(); });
+            joined_ = true;
+        }
+    }
+
+    int workers() const { return workers_; }
+    // 每個 worker 一個 shard；執行中也可由其他執行緒讀取快照（例如 StatsReporter）
+    const ShardedStats& stats() const { return stats_; }
+
+private:
+    using Task = std::optional<std::pair<size_t, Item>>;
+
+    void run_worker(int w) {
+        // 每個 worker 處理整張影像，影像內部的迴圈與 OpenCV 函式依序執行
+        FrameParallelScope scope;
+        Task task;
+        for (;;) {
+            queue_.pop(task);
+            if (!task) {
+                break;
+            }
+            double time = handler_(task->second, w);
+            stats_.add(w, time, (int64_t)task->first);
+        }
+    }
+
+    int workers_;
+    Handler handler_;
+    tbb::task_arena arena_;
+    tbb::task_group group_;
+    tbb::concurrent_bounded_queue<Task> queue_;
+    ShardedStats stats_;
+    size_t pushed_ = 0;
+    bool closed_ = false;
+    bool joined_ = false;
+};
+
+} // namespace droplet
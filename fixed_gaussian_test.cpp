@@ -0,0 +1,105 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "droplet_engine/fixed_gaussian.hpp"
+
+using namespace cv;
+using namespace std;
+
+// ctest 以 OPENCV_CPU_DISABLE 關掉較新的指令集，逐一執行每個路徑；
+// 這台機器選不到指定的指令集時回傳 kSkipped（不支援或 OpenCV 不允許關掉的基準指令集）
+const int kSkipped = 77;
+
+// 1、2 像素寬 / 高的影像中補邊的像素都來自反射；更大的尺寸跨過 SIMD 寬度與 64 列的列帶
+const vector<int> kSmall = { 1, 2, 4, 7, 17 };
+const vector<Size> kLarge = { {130, 200}, {257, 65}, {64, 64} };
+
+void fill_random(mt19937& rng, Mat& m) {
+    for (int y = 0; y < m.rows; ++y) {
+        for (int x = 0; x < m.cols; ++x) {
+            m.at<uchar>(y, x) = (uchar)(rng() & 255);
+        }
+    }
+}
+
+// 較大影像中的 ROI，外圍也是隨機值
+Mat random_roi(mt19937& rng, Size size, Mat& parent) {
+    parent.create(size.height + 5, size.width + 7, CV_8UC1);
+    fill_random(rng, parent);
+    return parent(Rect(4, 3, size.width, size.height));
+}
+
+bool same(const Mat& a, const Mat& b) {
+    return a.size() == b.size() && norm(a, b, NORM_INF) == 0;
+}
+
+// 與 cv::GaussianBlur(sigma = 0) 逐位元比對：連續影像、ROI（不讀 ROI 以外的像素）、就地模糊（含 ROI）
+bool check_size(mt19937& rng, Size size, int ksize, int& cases) {
+    bool ok = true;
+    Mat expected, dst;
+
+    Mat image(size, CV_8UC1);
+    fill_random(rng, image);
+    GaussianBlur(image, expected, Size(ksize, ksize), 0);
+    droplet::fixed_gaussian_blur(image, dst, ksize);
+    ok &= same(dst, expected);
+
+    Mat parent;
+    Mat roi = random_roi(rng, size, parent);
+    GaussianBlur(roi, expected, Size(ksize, ksize), 0, 0, BORDER_DEFAULT | BORDER_ISOLATED);
+    droplet::fixed_gaussian_blur(roi, dst, ksize);
+    ok &= same(dst, expected);
+
+    Mat in_place = image.clone();
+    GaussianBlur(image, expected, Size(ksize, ksize), 0);
+    droplet::fixed_gaussian_blur(in_place, in_place, ksize);
+    ok &= same(in_place, expected);
+
+    // 就地模糊 ROI：結果寫回同一塊記憶體，ROI 外圍不變
+    Mat before = parent.clone();
+    GaussianBlur(roi, expected, Size(ksize, ksize), 0, 0, BORDER_DEFAULT | BORDER_ISOLATED);
+    const uchar* data = roi.data;
+    droplet::fixed_gaussian_blur(roi, roi, ksize);
+    ok &= roi.data == data && same(roi, expected);
+    Mat untouched = before.clone();
+    Mat inner = untouched(Rect(4, 3, size.width, size.height));
+    expected.copyTo(inner);
+    ok &= same(parent, untouched);
+
+    cases += 4;
+    if (!ok) {
+        cout << "  mismatch at " << size.width << "x" << size.height << ", ksize " << ksize << endl;
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    cv::utils::logging::setLogLevel(cv::utils::logging::LOG_LEVEL_ERROR);
+
+    string isa = droplet::fixed_gaussian_isa();
+    if (argc > 1 && isa != argv[1]) {
+        cout << "SKIP: expected " << argv[1] << ", selected " << isa << endl;
+        return kSkipped;
+    }
+
+    mt19937 rng(20240612);
+    bool ok = true;
+    int cases = 0;
+    for (int ksize : { 3, 5 }) {
+        for (int height : kSmall) {
+            for (int width : kSmall) {
+                ok &= check_size(rng, Size(width, height), ksize, cases);
+            }
+        }
+        for (Size size : kLarge) {
+            ok &= check_size(rng, size, ksize, cases);
+        }
+    }
+
+    cout << (ok ? "PASS " : "FAIL ") << "fixed_gaussian_blur (" << isa << "): " << cases
+         << " cases against cv::GaussianBlur" << endl;
+    return ok ? 0 : 1;
+}
@@ -6,86 +6,22 @@
 #include <vector>
 #include <iomanip>
 
-#define _USE_MATH_DEFINES
-#include <math.h>
+#include "droplet_engine/distance_morphology.hpp"
+#include "droplet_engine/pipeline.hpp"
 
 using namespace cv;
 using namespace std;
 using namespace std::chrono;
+using droplet::ContourMetrics;
 
-struct ContourMetrics {
-    double area_original;
-    double area_hull;
-    double area_ratio;
-    double circularity_original;
-    double circularity_hull;
-    double circularity_ratio;
-    vector<Point> contour;
-    vector<Point> hull;
-};
-
-ContourMetrics calculate_contour_metrics(const vector<vector<Point>>& contours) {
-    ContourMetrics results;
-    if (contours.empty()) {
-        return results;
-    }
-
-    auto cnt = *max_element(contours.begin(), contours.end(),
-        [](const vector<Point>& c1, const vector<Point>& c2) {
-            return contourArea(c1) < contourArea(c2);
-        });
-
-    results.area_original = contourArea(cnt);
-    double perimeter_original = arcLength(cnt, true);
-    results.circularity_original = (2 * sqrt(M_PI * results.area_original)) / perimeter_original;
-
-    convexHull(cnt, results.hull);
-
-    results.area_hull = contourArea(results.hull);
-    double perimeter_hull = arcLength(results.hull, true);
-    results.circularity_hull = (2 * sqrt(M_PI * results.area_hull)) / perimeter_hull;
-
-    results.area_ratio = results.area_hull / results.area_original;
-    results.circularity_ratio = results.circularity_hull / results.circularity_original;
-
-    results.contour = cnt;
-
-    return results;
-}
-
-ContourMetrics process_image(const string& img_path, const Mat& background, int kernel_shape, int kernel_size) {
+ContourMetrics process_image(const string& img_path, const droplet::DropletPipeline& pipeline) {
     Mat img = imread(img_path, IMREAD_GRAYSCALE);
     if (img.empty()) {
         cout << "Error: Unable to read image: " << img_path << endl;
         return ContourMetrics();
     }
 
-    Mat blur_img, blur_background;
-    GaussianBlur(img, blur_img, Size(3, 3), 0);
-    GaussianBlur(background, blur_background, Size(3, 3), 0);
-
-    Mat substract;
-    subtract(blur_background, blur_img, substract);
-
-    Mat binary;
-    threshold(substract, binary, 10, 255, THRESH_BINARY);
-
-    Mat kernel = getStructuringElement(kernel_shape, Size(kernel_size, kernel_size));
-
-    Mat erode1, dilate1, dilate2, erode2;
-    erode(binary, erode1, kernel);
-    dilate(erode1, dilate1, kernel);
-    dilate(dilate1, dilate2, kernel);
-    erode(dilate2, erode2, kernel);
-
-    Mat edge;
-    Canny(erode2, edge, 50, 150);
-
-    vector<vector<Point>> contours;
-    vector<Vec4i> hierarchy;
-    findContours(edge, contours, hierarchy, RETR_EXTERNAL, CHAIN_APPROX_NONE);
-
-    return calculate_contour_metrics(contours);
+    return pipeline.process(img);
 }
 
 int main() {
@@ -110,12 +46,79 @@ int main() {
 
     vector<int> kernel_sizes = {3, 5, 7};
 
+    // 距離場形態學：每種形狀只算一次距離場，各大小只是一次門檻
+    Mat sweep_sample = imread(img_path, IMREAD_GRAYSCALE);
+    if (!sweep_sample.empty()) {
+        droplet::DropletPipeline sweep_pipeline(droplet::PipelineConfig::open_close_flow());
+        sweep_pipeline.set_background(background);
+        Mat binary;
+        sweep_pipeline.segment(sweep_sample, binary);
+
+        droplet::DistanceField field;
+        for (const auto& shape : kernel_shapes) {
+            droplet::DistanceMetric metric;
+            int radius;
+            if (!droplet::distance_morph_kernel(shape.first, 3, metric, radius)) {
+                continue;
+            }
+            auto field_start = high_resolution_clock::now();
+            field.compute(binary, metric, droplet::DistanceField::Background);
+            auto field_end = high_resolution_clock::now();
+            cout << "Distance field (" << shape.second << "): "
+                 << duration_cast<microseconds>(field_end - field_start).count() << " us" << endl;
+
+            for (int size : kernel_sizes) {
+                Mat eroded;
+                auto threshold_start = high_resolution_clock::now();
+                field.threshold(size / 2, eroded);
+                auto threshold_end = high_resolution_clock::now();
+                cout << "  erode " << size << "x" << size << ": "
+                     << duration_cast<microseconds>(threshold_end - threshold_start).count() << " us";
+                // 矩形與 3x3 十字應與 OpenCV 逐位元相同；橢圓只是近似
+                if (droplet::distance_morph_kernel(shape.first, size, metric, radius) && shape.first != MORPH_ELLIPSE) {
+                    Mat expected;
+                    cv::erode(binary, expected, getStructuringElement(shape.first, Size(size, size)));
+                    cout << ", matches OpenCV: " << (norm(eroded, expected, NORM_INF) == 0 ? "yes" : "NO");
+                }
+                cout << endl;
+            }
+        }
+        cout << endl;
+    }
+
     for (const auto& shape : kernel_shapes) {
         for (int size : kernel_sizes) {
             cout << "Testing " << shape.second << " kernel of size " << size << "x" << size << ":" << endl;
 
+            droplet::PipelineConfig config = droplet::PipelineConfig::open_close_flow();
+            config.kernel_shape = shape.first;
+            config.kernel_size = size;
+            droplet::DropletPipeline pipeline(config);
+            pipeline.set_background(background);
+
+            // 化簡後的形態學與逐次迭代的 OpenCV 結果比對
+            Mat sample = imread(img_path, IMREAD_GRAYSCALE), binary;
+            if (!sample.empty()) {
+                pipeline.segment(sample, binary);
+                bool exact = droplet::verify_morphology_plan(config.morphology, config.kernel_shape, config.kernel_size, binary);
+                cout << "Morphology plan matches OpenCV: " << (exact ? "yes" : "NO") << endl;
+
+                // SIMD 腐蝕 / 膨脹與 OpenCV 逐位元比對；三種形狀、各種大小的成本應該相近
+                Mat kernel = getStructuringElement(shape.first, Size(size, size));
+                Mat expected_erode, expected_dilate, eroded, dilated;
+                cv::erode(binary, expected_erode, kernel);
+                cv::dilate(binary, expected_dilate, kernel);
+                auto morph_start = high_resolution_clock::now();
+                droplet::parallel_erode(binary, eroded, kernel);
+                droplet::parallel_dilate(binary, dilated, kernel);
+                auto morph_end = high_resolution_clock::now();
+                bool same = norm(eroded, expected_erode, NORM_INF) == 0 && norm(dilated, expected_dilate, NORM_INF) == 0;
+                cout << "parallel_erode/dilate match OpenCV: " << (same ? "yes" : "NO") << " ("
+                     << duration_cast<microseconds>(morph_end - morph_start).count() << " us)" << endl;
+            }
+
             auto start_time = high_resolution_clock::now();
-            ContourMetrics results = process_image(img_path, background, shape.first, size);
+            ContourMetrics results = process_image(img_path, pipeline);
             auto end_time = high_resolution_clock::now();
 
             auto process_time = duration_cast<microseconds>(end_time - start_time).count() / 1e6;
@@ -134,8 +137,8 @@ int main() {
             Mat hull_contour_image = Mat::zeros(background.size(), CV_8U);
 
             if (!results.contour.empty()) {
-                drawContours(original_contour_image, vector<vector<Point>>{results.contour}, -1, Scalar(255), 1);
-                drawContours(hull_contour_image, vector<vector<Point>>{results.hull}, -1, Scalar(255), 1);
+                drawContours(original_contour_image, vector<vector<Point>>{results.contour.to_vector()}, -1, Scalar(255), 1);
+                drawContours(hull_contour_image, vector<vector<Point>>{results.hull.to_vector()}, -1, Scalar(255), 1);
 
                 imshow("Original Contour - " + shape.second + " " + to_string(size) + "x" + to_string(size), original_contour_image);
                 imshow("Convex Hull - " + shape.second + " " + to_string(size) + "x" + to_string(size), hull_contour_image);
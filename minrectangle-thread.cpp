@@ -14,199 +14,123 @@ using namespace std;
 #include <cstdio> //含c語言printf
 #include <string>
 #include <thread>
-#include <queue>
-#include <mutex>
-#include <condition_variable>
 #include <numeric>
-#include <tbb/task_arena.h>
-#include <tbb/task_group.h>
-#include <tbb/concurrent_queue.h>
-#include <atomic>
+#include <algorithm>
 #include <fstream>
 
-struct ContourMetrics {
-    double area_original;
-    double area_hull;
-    double area_ratio;
-    double circularity_original;
-    double circularity_hull;
-    double circularity_ratio;
-};
+#include "droplet_engine/pipeline.hpp"
+#include "droplet_engine/sharded_stats.hpp"
+#include "droplet_engine/threading_policy.hpp"
+#include "droplet_engine/worker_pool.hpp"
+using droplet::ContourMetrics;
 
-ContourMetrics calculate_contour_metrics(const vector<vector<Point>>& contours)         //取contours位置的值作為輸入，且形式是多輪廓的向量
-    {if (contours.empty()) {
-        printf("No contours to calculate metrics.\n");
-        return ContourMetrics();
-    }
-    auto cnt = *max_element(contours.begin(), contours.end(),
-    [](const auto& c1, const auto& c2) { return contourArea(c1) < contourArea(c2); });//這邊是一個一個比，或許可優化(並行)
-    
-    double area_original = contourArea(cnt);
-    double perimeter_original = arcLength(cnt, true);
-
-    if (area_original <= 1e-6 || perimeter_original <= 1e-6) {
-        printf("Invalid contour measurements: area=%f, perimeter=%f\n", area_original, perimeter_original);
-        return ContourMetrics();
-    }
-
-    double circularity_original = 2 * sqrt(M_PI * area_original) / perimeter_original;
-
-    //凸包處理
-    vector<Point> hull; //創建hull向量儲存cvpoint
-    convexHull(cnt, hull); //hull=convexHull(cnt)
-
-    double area_hull = contourArea(hull);
-    double perimeter_hull = arcLength(hull, true);
-
-    if (area_hull <= 1e-6 || perimeter_hull <= 1e-6) {
-        printf("Invalid hull measurements: area=%f, perimeter=%f\n",area_hull,perimeter_hull);
-        return ContourMetrics();
-    }
-
-    double circularity_hull = 2 * sqrt(M_PI * area_hull) / perimeter_hull;
-
-    ContourMetrics results;
-    results.area_original = area_original;
-    results.area_hull = area_hull;
-    results.area_ratio = area_hull / area_original;
-    results.circularity_original = circularity_original;
-    results.circularity_hull = circularity_hull;
-    results.circularity_ratio = circularity_hull / circularity_original;
-    return results;
-}
-
-void process_image_cropped(const string& image_path, const Mat& blurred_bg, double& numbersum, vector<vector<Point>>& contours, ContourMetrics& metrics, double& duration, double& number)  //constant為輸入值，非constant為輸出
+double process_image_cropped(const string& image_path, const droplet::DropletPipeline& pipeline, droplet::RoiTracker& tracker, droplet::PipelineWorkspace& workspace, vector<vector<Point>>& contours, ContourMetrics& metrics)  //回傳處理時間（us）
     {
     Mat image = imread(image_path, IMREAD_GRAYSCALE);
     auto start_time = std::chrono::high_resolution_clock::now();
-    Mat kernel = getStructuringElement(MORPH_CROSS, Size(3, 3));
-    Mat blurred;
-    GaussianBlur(image, blurred, Size(5, 5), 0);
-    Mat bg_sub;
-    subtract(blurred_bg, blurred, bg_sub);
-    Mat binary;
-    threshold(bg_sub, binary, 10, 255, THRESH_BINARY);
-    vector<vector<Point>> contoursbi;  //指定內部向量包含一組point點，每一個內部向量代表一個輪廓，外部向量代表多個輪廓
-    vector<Vec4i> hierarchybi; //hierarchy: 存儲輪廓之間的層次關係信息
-    cv::findContours(binary, contoursbi, hierarchybi, RETR_EXTERNAL, CHAIN_APPROX_NONE);
-    if (contoursbi.empty()) {
-    printf("No contours found in the image.\n");
-    return;
-    }
-    if (contoursbi.size() > 1) {
-    printf("More than one contour found. Exiting.\n");
-    return;}
-    Rect bounding_box = boundingRect(contoursbi[0]); // 初始化5為第一個輪廓的邊界矩形
-    int padding = 30;
-    bounding_box.x = std::max(0, bounding_box.x - padding);
-    bounding_box.y = std::max(0, bounding_box.y - padding);
-    bounding_box.width = std::min(binary.cols - bounding_box.x, bounding_box.width + 2 * padding);
-    bounding_box.height = std::min(binary.rows - bounding_box.y, bounding_box.height + 2 * padding);
-    // 裁剪圖像
-    // 直接裁切 binary
-    binary = binary(bounding_box);
-    
-    /*//or 創建新圖片cropped
-    Mat cropped = binary(bounding_box).clone();*/
-    
-    Mat dilate1, erode1, dilate2;
-    cv::dilate(binary, dilate1, kernel, Point(), 2);  //point:錨點（anchor）的位置。表示使用結構元素的中心作為錨點，未指定寂寞認為(-1,-1)，默認值與python相同
-    cv::erode(dilate1, erode1, kernel, Point(), 3);
-    cv::dilate(erode1, dilate2, kernel, Point(), 1);
-
-
-    /*Mat edges;
-    Canny(dilate2, edges, 50, 150);*/
-
-    //vector<vector<Point>> contours;  //指定內部向量包含一組point點，每一個內部向量代表一個輪廓，外部向量代表多個輪廓
-    vector<Vec4i> hierarchy; //hierarchy: 存儲輪廓之間的層次關係信息
-    cv::findContours(dilate2, contours, hierarchy, RETR_LIST, CHAIN_APPROX_NONE);
-    metrics = calculate_contour_metrics(contours);
+    metrics = pipeline.process_tracked(image, tracker, contours, workspace);  //先處理預測視窗，失準時才處理整張
     auto end_time = std::chrono::high_resolution_clock::now();
-    #pragma warning(push)
-    #pragma warning(disable : 4244)
-    duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
-    #pragma warning(pop)
-    
-    //printf("process time: %f us \n", duration);
-    number=numbersum+1;
+    switch (metrics.status) {
+    case droplet::FrameStatus::NoContour:
+        printf("No contours found in the image.\n");
+        break;
+    case droplet::FrameStatus::MultipleContours:
+        printf("More than one contour found. Exiting.\n");
+        break;
+    case droplet::FrameStatus::InvalidMeasurement:
+        printf("Invalid contour measurements.\n");
+        break;
+    default:
+        break;
+    }
+    return std::chrono::duration<double, std::micro>(end_time - start_time).count();
 }
 
-struct ImageResult {
-    string path;
-    vector<vector<Point>> contours;
-    ContourMetrics metrics;
-    double processtime;
-};
+void thread_main(const string &directory,const droplet::DropletPipeline& pipeline, double& Average_processtime_minrec_thread,double& max_processing_time_minrec_thread,std::string &max_processing_time_image_minrec_thread) {    
+    // 統計只記索引，路徑留在這裡對照。directory_iterator 的順序不是拍攝順序，
+    // tracker 需要依檔名（幀序）排序後的影像
+    vector<fs::path> paths;
+    for (const auto& entry : fs::directory_iterator(directory)) {
+        if (entry.path().extension() == ".tiff" && entry.path().filename() != "background.tiff") {
+            paths.push_back(entry.path());
+        }
+    }
+    sort(paths.begin(), paths.end(), [](const fs::path& a, const fs::path& b) {
+        return a.filename() < b.filename();
+    });
 
-void thread_main(const string &directory,const cv::Mat& blurred_bg, double& Average_processtime_minrec_thread,double& max_processing_time_minrec_thread,std::string &max_processing_time_image_minrec_thread) {    
-    std::atomic<double> totaltime_c = 0;
-    max_processing_time_minrec_thread=0;
-    std::mutex mtx;
-    tbb::task_arena arena(std::thread::hardware_concurrency());
-    tbb::task_group group;
-    tbb::concurrent_queue<fs::path> image_queue;
+    // 等速模型需要連續的幀：影像切成 worker 數個連續區段，每段由一個 worker 依序處理，
+    // 各段有自己的 tracker（段首的幾張以整張影像暖機）；中間緩衝每個 worker 一份
+    droplet::WorkerPool& pool = droplet::WorkerPool::shared();
+    size_t segments = std::min(paths.size(), (size_t)pool.size());
+    vector<droplet::RoiTracker> trackers(segments);
+    droplet::WorkerLocal<droplet::PipelineWorkspace> workspaces(pool);
+    droplet::ShardedStats stats(pool.size());
+
+    // 每秒合併一次各 worker 的 shard 回報進度；worker 寫入統計不需要任何同步
+    droplet::StatsReporter reporter(stats, std::chrono::seconds(1), [](const droplet::TimeStats& stats, bool final) {
+        if (!final) {
+            printf("progress: %llu images, average %f us, max %f us\n",
+                   (unsigned long long)stats.count, stats.average(), stats.max);
+        }
+    });
 
-    std::atomic<bool> processing_complete(false);
-    double numbersum=0,number=0;
-    // 啟動處理線程
-    arena.execute([&]() {
-        group.run([&]() {
-            while (!processing_complete || !image_queue.empty()) {
-                fs::path path;
-                if (image_queue.try_pop(path)) {
-                    vector<vector<Point>> contours;
-                    ContourMetrics metrics;
-                    double processtime;
-                    process_image_cropped(path.string(), blurred_bg, numbersum, contours, metrics, processtime, number);
-                    if (!contours.empty()) {
-                        printf("processing: %s\n",path.filename().string().c_str());
-                        printf("processtime= %f\n",processtime);
-                        printf("Original area: %f\n", metrics.area_original);
-                        printf("Convex Hull area: %f\n", metrics.area_hull);
-                        printf("Area ratio (hull/original): %f\n", metrics.area_ratio);
-                        printf("Original circularity: %f\n", metrics.circularity_original);
-                        printf("Convex Hull circularity: %f\n", metrics.circularity_hull);
-                        printf("Circularity ratio (hull/original): %f\n", metrics.circularity_ratio);
-                        printf("\n");}
-                    {
-                        std::lock_guard<std::mutex> lock(mtx);
-                        totaltime_c = totaltime_c + processtime;
-                        if (processtime > max_processing_time_minrec_thread) {
-                            max_processing_time_minrec_thread = processtime;
-                            max_processing_time_image_minrec_thread=path.filename().string().c_str();
-                        }
-                    numbersum=number;
-                    }
-                } 
-                else {
-                    std::this_thread::yield();
-                }
+    pool.run(segments, [&](size_t segment, int worker) {
+        size_t begin = paths.size() * segment / segments;
+        size_t end = paths.size() * (segment + 1) / segments;
+        for (size_t i = begin; i < end; ++i) {
+            vector<vector<Point>> contours;
+            ContourMetrics metrics;
+            double processtime = process_image_cropped(paths[i].string(), pipeline, trackers[segment], workspaces[worker], contours, metrics);
+            stats.add(worker, processtime, (int64_t)i);
+            if (!contours.empty()) {
+                //一次輸出整筆結果，避免多個 worker 的輸出交錯
+                printf("processing: %s\nprocesstime= %f\nOriginal area: %f\nConvex Hull area: %f\n"
+                       "Area ratio (hull/original): %f\nOriginal circularity: %f\nConvex Hull circularity: %f\n"
+                       "Circularity ratio (hull/original): %f\n\n",
+                       paths[i].filename().string().c_str(), processtime, metrics.area_original, metrics.area_hull,
+                       metrics.area_ratio, metrics.circularity_original, metrics.circularity_hull, metrics.circularity_ratio);
             }
-            Average_processtime_minrec_thread=totaltime_c/number;
-        });
+        }
     });
+    reporter.stop();
 
-    // 遍歷目錄並立即分發任務
-    for (const auto& entry : fs::directory_iterator(directory)) {
-        if (entry.path().extension() == ".tiff" && entry.path().filename() != "background.tiff") {
-            image_queue.push(entry.path());
-        }
+    droplet::TimeStats total = stats.snapshot();
+    Average_processtime_minrec_thread = total.average();
+    max_processing_time_minrec_thread = total.max;
+    max_processing_time_image_minrec_thread = total.argmax >= 0 ? paths[total.argmax].filename().string() : std::string();
+
+    int hits = 0, misses = 0;
+    for (const droplet::RoiTracker& tracker : trackers) {
+        hits += tracker.hits();
+        misses += tracker.misses();
+    }
+    printf("ROI hits: %d   full-frame fallbacks: %d\n", hits, misses);
+    for (int w = 0; w < stats.size(); ++w) {
+        droplet::TimeStats shard = stats.shard_snapshot(w);
+        printf("worker %d: %llu images, average %f us, p99 <= %f us\n",
+               w, (unsigned long long)shard.count, shard.average(), shard.quantile(0.99));
     }
-    processing_complete = true;
-    group.wait();
 }
 
 
 int main () {
+    // OpenCV 的 parallel_for_ 交給共用的 pool；跨影像平行時影像內部依序執行，不會巢狀開執行緒
+    droplet::install_opencv_backend();
+
     string directory = "Test_images/Cropped";
     string background_path = directory + "/background.tiff";
     Mat background = imread(background_path, IMREAD_GRAYSCALE);
-    Mat blurred_bg;
-    GaussianBlur(background, blurred_bg, Size(5, 5), 0);
+    droplet::PipelineConfig config = droplet::PipelineConfig::linear_flow();
+    config.edge = droplet::EdgeMode::None;
+    config.crop_to_droplet = true;
+    config.morph_backend = droplet::MorphBackend::BitPacked;
+    config.metrics.circularity = droplet::CircularityFormula::SqrtRatio;
+    droplet::DropletPipeline pipeline(config);
+    pipeline.set_background(background);
     double avrtime_o, max_processtime_o;
     std::string max_processing_time_image_o;
-    thread_main(directory, blurred_bg, avrtime_o,max_processtime_o,max_processing_time_image_o);
+    thread_main(directory, pipeline, avrtime_o,max_processtime_o,max_processing_time_image_o);
     printf("averagetime=%f       maximum processtime= %f      max process image=%s \n",avrtime_o, max_processtime_o, max_processing_time_image_o.c_str());
 
     return 0;
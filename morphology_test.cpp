@@ -0,0 +1,164 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "droplet_engine/distance_morphology.hpp"
+#include "droplet_engine/morphology.hpp"
+
+using namespace cv;
+using namespace std;
+using droplet::MorphOp;
+using droplet::MorphStep;
+
+const vector<pair<int, string>> kShapes = { {MORPH_RECT, "RECT"}, {MORPH_CROSS, "CROSS"}, {MORPH_ELLIPSE, "ELLIPSE"} };
+const vector<int> kKernelSizes = { 3, 5, 7 };
+// 比核窄 / 矮的影像、單列與單欄，以及高過一個列帶（64 列）的影像，檢查補邊與列帶接縫
+const vector<Size> kMaskSizes = { {1, 1}, {2, 3}, {3, 2}, {1, 40}, {40, 1}, {5, 6}, {37, 29}, {45, 150}, {200, 130} };
+
+void fill_random(mt19937& rng, Mat& m, bool binary) {
+    for (int y = 0; y < m.rows; ++y) {
+        for (int x = 0; x < m.cols; ++x) {
+            // 二值遮罩約七成為前景，腐蝕幾次後仍有前景
+            m.at<uchar>(y, x) = binary ? (rng() % 10 < 7 ? 255 : 0) : (uchar)(rng() & 255);
+        }
+    }
+}
+
+// 較大影像中的 ROI，外圍也是隨機值
+Mat random_roi(mt19937& rng, Size size, bool binary) {
+    Mat parent(size.height + 6, size.width + 8, CV_8UC1);
+    fill_random(rng, parent, binary);
+    return parent(Rect(5, 3, size.width, size.height));
+}
+
+bool same(const Mat& a, const Mat& b) {
+    return a.size() == b.size() && norm(a, b, NORM_INF) == 0;
+}
+
+void morph_once(MorphOp op, const Mat& src, Mat& dst, const Mat& kernel) {
+    if (op == MorphOp::Erode) {
+        droplet::parallel_erode(src, dst, kernel);
+    } else {
+        droplet::parallel_dilate(src, dst, kernel);
+    }
+}
+
+// 連續做 iterations 次，每次的輸入是上一次的輸出（第二次起 dst 與 src 相同）
+void repeat(MorphOp op, const Mat& src, Mat& dst, const Mat& kernel, int iterations) {
+    dst = Mat();
+    morph_once(op, src, dst, kernel);
+    for (int i = 1; i < iterations; ++i) {
+        morph_once(op, dst, dst, kernel);
+    }
+}
+
+// parallel_erode / parallel_dilate 重複 n 次必須與 cv::erode / cv::dilate(iterations = n) 逐位元相同
+bool check_parallel(mt19937& rng) {
+    bool ok = true;
+    for (const auto& shape : kShapes) {
+        int cases = 0, mismatches = 0;
+        for (int ksize : kKernelSizes) {
+            Mat kernel = getStructuringElement(shape.first, Size(ksize, ksize));
+            for (Size size : kMaskSizes) {
+                for (bool binary : { true, false }) {
+                    Mat src = random_roi(rng, size, binary);
+                    for (int iterations : { 1, 2, 3 }) {
+                        for (MorphOp op : { MorphOp::Erode, MorphOp::Dilate }) {
+                            Mat expected, dst;
+                            if (op == MorphOp::Erode) {
+                                cv::erode(src, expected, kernel, Point(-1, -1), iterations, droplet::kIsolatedBorder,
+                                          morphologyDefaultBorderValue());
+                            } else {
+                                cv::dilate(src, expected, kernel, Point(-1, -1), iterations, droplet::kIsolatedBorder,
+                                           morphologyDefaultBorderValue());
+                            }
+                            repeat(op, src, dst, kernel, iterations);
+                            if (!same(dst, expected)) {
+                                ++mismatches;
+                                cout << "  mismatch: " << shape.second << " " << ksize << "x" << ksize << " "
+                                     << (op == MorphOp::Erode ? "erode" : "dilate") << " x" << iterations << " on "
+                                     << size.width << "x" << size.height << (binary ? " mask" : " grey") << endl;
+                            }
+                            ++cases;
+                        }
+                    }
+                }
+            }
+        }
+        ok &= mismatches == 0;
+        cout << (mismatches == 0 ? "PASS " : "FAIL ") << "parallel_erode/dilate " << shape.second << ": "
+             << mismatches << " / " << cases << " mismatches" << endl;
+    }
+    return ok;
+}
+
+// 腐蝕、膨脹、開運算、閉運算，以及會合併成一段的相鄰同類步驟
+const vector<pair<vector<MorphStep>, string>> kChains = {
+    { { {MorphOp::Erode, 1} }, "erode" },
+    { { {MorphOp::Dilate, 2} }, "dilate x2" },
+    { { {MorphOp::Erode, 1}, {MorphOp::Dilate, 1} }, "open" },
+    { { {MorphOp::Dilate, 2}, {MorphOp::Erode, 2} }, "close x2" },
+    { { {MorphOp::Erode, 1}, {MorphOp::Erode, 2}, {MorphOp::Dilate, 3} }, "erode + erode x2 + dilate x3" },
+};
+
+// 距離場形態學：distance_morph_kernel 標為精確的結構元素（奇數 MORPH_RECT、3x3 MORPH_CROSS），
+// run_distance_morphology 整串步驟必須與逐步 cv::erode / cv::dilate 逐位元相同
+bool check_distance(mt19937& rng) {
+    const vector<pair<int, int>> kernels = { {MORPH_RECT, 3}, {MORPH_RECT, 5}, {MORPH_RECT, 7}, {MORPH_CROSS, 3} };
+    bool ok = true;
+    int cases = 0, mismatches = 0;
+    droplet::DistanceField field;
+    for (const auto& k : kernels) {
+        droplet::DistanceMetric metric;
+        int radius = 0;
+        ok &= droplet::distance_morph_kernel(k.first, k.second, metric, radius);
+        Mat kernel = getStructuringElement(k.first, Size(k.second, k.second));
+        for (Size size : kMaskSizes) {
+            Mat src = random_roi(rng, size, true);
+            for (const auto& chain : kChains) {
+                Mat expected = src.clone();
+                for (const MorphStep& step : chain.first) {
+                    if (step.op == MorphOp::Erode) {
+                        cv::erode(expected, expected, kernel, Point(-1, -1), step.iterations, droplet::kIsolatedBorder,
+                                  morphologyDefaultBorderValue());
+                    } else {
+                        cv::dilate(expected, expected, kernel, Point(-1, -1), step.iterations, droplet::kIsolatedBorder,
+                                   morphologyDefaultBorderValue());
+                    }
+                }
+
+                // ping / pong 為較大影像的 ROI（與 PipelineWorkspace 相同）
+                Mat parent(size.height * 2 + 1, size.width, CV_8UC1);
+                Mat ping = parent(Rect(0, 0, size.width, size.height));
+                Mat pong = parent(Rect(0, size.height + 1, size.width, size.height));
+                Mat dst;
+                droplet::run_distance_morphology(chain.first, metric, radius, src, dst, field, ping, pong);
+                if (!same(dst, expected)) {
+                    ++mismatches;
+                    cout << "  mismatch: " << (k.first == MORPH_RECT ? "RECT " : "CROSS ") << k.second << "x"
+                         << k.second << " " << chain.second << " on " << size.width << "x" << size.height << endl;
+                }
+                ++cases;
+            }
+        }
+    }
+
+    ok &= mismatches == 0;
+    cout << (ok ? "PASS " : "FAIL ") << "run_distance_morphology RECT / 3x3 CROSS: " << mismatches << " / " << cases
+         << " mismatches" << endl;
+    return ok;
+}
+
+int main() {
+    cv::utils::logging::setLogLevel(cv::utils::logging::LOG_LEVEL_ERROR);
+
+    mt19937 rng(20240613);
+    bool ok = true;
+    ok &= check_parallel(rng);
+    ok &= check_distance(rng);
+
+    return ok ? 0 : 1;
+}
@@ -7,105 +7,30 @@
 #include <iomanip>
 #include <omp.h>
 
-#define _USE_MATH_DEFINES
-#include <math.h>
+#include "droplet_engine/pipeline.hpp"
+#include "droplet_engine/threading_policy.hpp"
 
 using namespace cv;
 using namespace std;
 using namespace std::chrono;
+using droplet::ContourMetrics;
 
-struct ContourMetrics {
-    double area_original;
-    double area_hull;
-    double area_ratio;
-    double circularity_original;
-    double circularity_hull;
-    double circularity_ratio;
-    vector<Point> contour;
-    vector<Point> hull;
-};
-
-ContourMetrics calculate_contour_metrics(const vector<vector<Point>>& contours) {
-    ContourMetrics results;
-    if (contours.empty()) {
-        return results;
-    }
-
-    auto cnt = *max_element(contours.begin(), contours.end(),
-        [](const vector<Point>& c1, const vector<Point>& c2) {
-            return contourArea(c1) < contourArea(c2);
-        });
-
-    results.area_original = contourArea(cnt);
-    double perimeter_original = arcLength(cnt, true);
-    results.circularity_original = (2 * sqrt(M_PI * results.area_original)) / perimeter_original;
-
-    convexHull(cnt, results.hull);
-
-    results.area_hull = contourArea(results.hull);
-    double perimeter_hull = arcLength(results.hull, true);
-    results.circularity_hull = (2 * sqrt(M_PI * results.area_hull)) / perimeter_hull;
-
-    results.area_ratio = results.area_hull / results.area_original;
-    results.circularity_ratio = results.circularity_hull / results.circularity_original;
-
-    results.contour = cnt;
-
-    return results;
-}
-
-ContourMetrics process_image(const string& img_path, const Mat& background) {
+ContourMetrics process_image(const string& img_path, const droplet::DropletPipeline& pipeline) {
     Mat img = imread(img_path, IMREAD_GRAYSCALE);
     if (img.empty()) {
         cout << "Error: Unable to read image: " << img_path << endl;
         return ContourMetrics();
     }
 
-    Mat blur_img, blur_background, substract, binary, erode1, dilate1, dilate2, erode2, edge;
-
-    #pragma omp parallel sections
-    {
-        #pragma omp section
-        {
-            GaussianBlur(img, blur_img, Size(3, 3), 0);
-        }
-        #pragma omp section
-        {
-            GaussianBlur(background, blur_background, Size(3, 3), 0);
-        }
-    }
-
-    subtract(blur_background, blur_img, substract);
-    threshold(substract, binary, 10, 255, THRESH_BINARY);
-
-    Mat kernel = getStructuringElement(MORPH_CROSS, Size(3, 3));
-
-    #pragma omp parallel sections
-    {
-        #pragma omp section
-        {
-            erode(binary, erode1, kernel);
-            dilate(erode1, dilate1, kernel);
-        }
-        #pragma omp section
-        {
-            dilate(binary, dilate2, kernel);
-            erode(dilate2, erode2, kernel);
-        }
-    }
-
-    Canny(erode2, edge, 50, 150);
-
-    vector<vector<Point>> contours;
-    vector<Vec4i> hierarchy;
-    findContours(edge, contours, hierarchy, RETR_EXTERNAL, CHAIN_APPROX_NONE);
-
-    return calculate_contour_metrics(contours);
+    return pipeline.process(img);
 }
 
 int main() {
     cv::utils::logging::setLogLevel(cv::utils::logging::LOG_LEVEL_ERROR);
     cout << "OpenCV version: " << CV_VERSION << endl;
+    // 只處理一張影像：平行放在影像內部，形態學迴圈與 OpenCV 函式都使用所有核心
+    droplet::set_threading_policy(droplet::ThreadingPolicy::within_frame());
+    droplet::install_opencv_backend();
 
     string img_folder = "Test_images\\Slight under focus\\";
     string background_path = img_folder + "background.tiff";
@@ -117,8 +42,14 @@ int main() {
         return -1;
     }
 
+    // 原本兩個 section 中只有 dilate -> erode 的結果被 Canny 使用
+    droplet::PipelineConfig config = droplet::PipelineConfig::open_close_flow();
+    config.morphology = { {droplet::MorphOp::Dilate, 1}, {droplet::MorphOp::Erode, 1} };
+    droplet::DropletPipeline pipeline(config);
+    pipeline.set_background(background);
+
     auto start_time = high_resolution_clock::now();
-    ContourMetrics results = process_image(img_path, background);
+    ContourMetrics results = process_image(img_path, pipeline);
     auto end_time = high_resolution_clock::now();
 
     auto process_time = duration_cast<microseconds>(end_time - start_time).count() / 1e6;
@@ -138,8 +69,8 @@ int main() {
     Mat hull_contour_image = Mat::zeros(background.size(), CV_8U);
 
     if (!results.contour.empty()) {
-        drawContours(original_contour_image, vector<vector<Point>>{results.contour}, -1, Scalar(255), 1);
-        drawContours(hull_contour_image, vector<vector<Point>>{results.hull}, -1, Scalar(255), 1);
+        drawContours(original_contour_image, vector<vector<Point>>{results.contour.to_vector()}, -1, Scalar(255), 1);
+        drawContours(hull_contour_image, vector<vector<Point>>{results.hull.to_vector()}, -1, Scalar(255), 1);
 
         imshow("Original Contour - 0066.tiff", original_contour_image);
         imshow("Convex Hull - 0066.tiff", hull_contour_image);
@@ -8,109 +8,36 @@
 #include <omp.h>
 #include <filesystem>
 #include <algorithm>
-#include <map>
 #include <numeric>
 
-#define _USE_MATH_DEFINES
-#include <math.h>
+#include "droplet_engine/ordered_sink.hpp"
+#include "droplet_engine/pipeline.hpp"
+#include "droplet_engine/result_table.hpp"
+#include "droplet_engine/threading_policy.hpp"
 
 using namespace cv;
 using namespace std;
 using namespace std::chrono;
 namespace fs = std::filesystem;
+using droplet::ContourMetrics;
 
-struct ContourMetrics {
-    double area_original;
-    double area_hull;
-    double area_ratio;
-    double circularity_original;
-    double circularity_hull;
-    double circularity_ratio;
-    vector<Point> contour;
-    vector<Point> hull;
-    long long process_time;
-};
-
-ContourMetrics calculate_contour_metrics(const vector<vector<Point>>& contours) {
-    ContourMetrics results;
-    if (contours.empty()) {
-        return results;
-    }
-
-    auto cnt = *max_element(contours.begin(), contours.end(),
-        [](const vector<Point>& c1, const vector<Point>& c2) {
-            return contourArea(c1) < contourArea(c2);
-        });
-
-    results.area_original = contourArea(cnt);
-    double perimeter_original = arcLength(cnt, true);
-    results.circularity_original = (2 * sqrt(M_PI * results.area_original)) / perimeter_original;
-
-    convexHull(cnt, results.hull);
-
-    results.area_hull = contourArea(results.hull);
-    double perimeter_hull = arcLength(results.hull, true);
-    results.circularity_hull = (2 * sqrt(M_PI * results.area_hull)) / perimeter_hull;
-
-    results.area_ratio = results.area_hull / results.area_original;
-    results.circularity_ratio = results.circularity_hull / results.circularity_original;
+// 同一段的影像共用同一版背景；段長固定，結果與執行緒數、完成先後無關
+const int kBackgroundBlock = 32;
 
-    results.contour = cnt;
-
-    return results;
-}
-
-ContourMetrics process_image(const string& img_path, const Mat& background) {
-    Mat img = imread(img_path, IMREAD_GRAYSCALE);
+ContourMetrics process_image(const string& img_path, const droplet::DropletPipeline& pipeline, Mat& img) {
+    img = imread(img_path, IMREAD_GRAYSCALE);
     if (img.empty()) {
         cout << "Error: Unable to read image: " << img_path << endl;
-        return ContourMetrics(); // 返回一个默认构造的 ContourMetrics 对象
-    }
-
-    Mat blur_img, blur_background, substract, binary, erode1, dilate1, dilate2, erode2, edge;
-
-    #pragma omp parallel sections
-    {
-        #pragma omp section
-        {
-            GaussianBlur(img, blur_img, Size(3, 3), 0);
-        }
-        #pragma omp section
-        {
-            GaussianBlur(background, blur_background, Size(3, 3), 0);
-        }
-    }
-
-    subtract(blur_background, blur_img, substract);
-    threshold(substract, binary, 10, 255, THRESH_BINARY);
-
-    Mat kernel = getStructuringElement(MORPH_CROSS, Size(3, 3));
-
-    #pragma omp parallel sections
-    {
-        #pragma omp section
-        {
-            erode(binary, erode1, kernel);
-            dilate(erode1, dilate1, kernel);
-        }
-        #pragma omp section
-        {
-            dilate(binary, dilate2, kernel);
-            erode(dilate2, erode2, kernel);
-        }
+        return ContourMetrics();
     }
 
-    Canny(erode2, edge, 50, 150);
-
-    vector<vector<Point>> contours;
-    vector<Vec4i> hierarchy;
-    findContours(edge, contours, hierarchy, RETR_EXTERNAL, CHAIN_APPROX_NONE);
-
-    return calculate_contour_metrics(contours);
+    return pipeline.process(img);
 }
 
 int main() {
     cv::utils::logging::setLogLevel(cv::utils::logging::LOG_LEVEL_ERROR);
+    // OpenCV 的 parallel_for_ 交給共用的 pool；跨影像平行時影像內部依序執行，不會巢狀開執行緒
+    droplet::install_opencv_backend();
 
     string img_folder = "Test_images\\Slight under focus\\";
     string background_path = img_folder + "background.tiff";
@@ -121,6 +48,12 @@ int main() {
         return -1;
     }
 
+    // 原本兩個 section 中只有 dilate -> erode 的結果被 Canny 使用
+    droplet::PipelineConfig config = droplet::PipelineConfig::open_close_flow();
+    config.morphology = { {droplet::MorphOp::Dilate, 1}, {droplet::MorphOp::Erode, 1} };
+    droplet::DropletPipeline pipeline(config);
+    droplet::BackgroundModel background_model(background);
+
     vector<fs::path> image_paths;
     for (const auto & entry : fs::directory_iterator(img_folder)) {
         if (entry.path().extension() == ".tiff" && entry.path().filename() != "background.tiff") {
@@ -132,63 +65,78 @@ int main() {
         return a.filename() < b.filename();
     });
 
-    map<fs::path, ContourMetrics> results;
-
-    #pragma omp parallel for
-    for (int i = 0; i < image_paths.size(); ++i) {
-        const auto& img_path = image_paths[i];
-        
-        auto start_time = high_resolution_clock::now();
-        ContourMetrics metrics = process_image(img_path.string(), background);
-        auto end_time = high_resolution_clock::now();
-
-        metrics.process_time = duration_cast<microseconds>(end_time - start_time).count();
+    // 每張影像的結果與時間寫入預先配置的格子（不需要 critical）；sink 依檔名順序串流輸出，
+    // submit 之前寫入的格子在輸出時可見。顯示視窗需要主執行緒，留到最後
+    droplet::ResultTable<ContourMetrics> results(image_paths.size());
+    int threads = omp_get_max_threads();
+    droplet::OrderedSink<Mat> sink(4 * threads, [&](size_t i, Mat& empty_frame) {
+        const auto& metrics = results[i].value;
+        // 沒有液滴的影像用來追蹤光源漂移；依影像順序更新，下一段才使用新版本
+        if (!empty_frame.empty()) {
+            background_model.update(empty_frame);
+        }
+        cout << "Processing " << image_paths[i].filename() << ":" << endl;
+        cout << fixed << setprecision(6);
+        cout << "Processing time: " << results[i].time << " microseconds" << endl;
+        cout << "Original area: " << metrics.area_original << endl;
+        cout << "Convex Hull area: " << metrics.area_hull << endl;
+        cout << "Area ratio (hull/original): " << metrics.area_ratio << endl;
+        cout << "Original circularity: " << metrics.circularity_original << endl;
+        cout << "Convex Hull circularity: " << metrics.circularity_hull << endl;
+        cout << "Circularity ratio (hull/original): " << metrics.circularity_ratio << endl;
+        cout << endl;
+    });
 
-        #pragma omp critical
-        {
-            results[img_path] = metrics;
+    // 每段開始前固定背景（前面各段空白影像的更新都已套用），段內的更新只影響之後的段，
+    // 因此每張影像用哪一版背景是確定的，結果可重現。
+    // dynamic 依序發放影像，超前 next 的張數不會超過執行緒數，重排視窗不會擋住負責 next 的執行緒。
+    // 這裡不用 WorkerPool 的分段竊取：各 worker 從不同區段開始，會遠遠超前重排視窗
+    int count = (int)image_paths.size();
+    for (int block = 0; block < count; block += kBackgroundBlock) {
+        pipeline.set_background(background_model.blurred(config.blur_size), true);
+        int block_end = min(count, block + kBackgroundBlock);
+
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int i = block; i < block_end; ++i) {
+            const auto& img_path = image_paths[i];
+
+            Mat img;
+            auto start_time = high_resolution_clock::now();
+            ContourMetrics metrics = process_image(img_path.string(), pipeline, img);
+            auto end_time = high_resolution_clock::now();
+
+            bool empty_frame = metrics.status == droplet::FrameStatus::NoContour;
+            results.set(i, std::move(metrics), duration<double, micro>(end_time - start_time).count());
+            sink.submit(i, empty_frame ? img : Mat());
         }
+        // parallel 區段結束時本段都已輸出（最後一次 submit 會把重排緩衝輸出完才返回）
     }
 
     // 计算平均处理时间
-    long long total_time = 0;
-    for (const auto& result : results) {
-        total_time += result.second.process_time;
-    }
-    double average_time = static_cast<double>(total_time) / results.size();
+    double average_time = results.average_time();
 
     // 打印平均处理时间
     cout << "Average processing time: " << fixed << setprecision(2) << average_time << " microseconds" << endl;
     cout << endl;
 
-    // 按順序輸出結果
-    for (const auto& img_path : image_paths) {
-        const auto& metrics = results[img_path];
-
-        cout << "Processing " << img_path.filename() << ":" << endl;
-        cout << fixed << setprecision(6);
-        cout << "Processing time: " << metrics.process_time << " microseconds" << endl;
-        cout << "Original area: " << metrics.area_original << endl;
-        cout << "Convex Hull area: " << metrics.area_hull << endl;
-        cout << "Area ratio (hull/original): " << metrics.area_ratio << endl;
-        cout << "Original circularity: " << metrics.circularity_original << endl;
-        cout << "Convex Hull circularity: " << metrics.circularity_hull << endl;
-        cout << "Circularity ratio (hull/original): " << metrics.circularity_ratio << endl;
-        cout << endl;
+    // 按順序顯示輪廓
+    for (size_t i = 0; i < image_paths.size(); ++i) {
+        const auto& img_path = image_paths[i];
+        const auto& metrics = results[i].value;
 
         Mat original_contour_image = Mat::zeros(background.size(), CV_8U);
         Mat hull_contour_image = Mat::zeros(background.size(), CV_8U);
 
         if (!metrics.contour.empty()) {
-            drawContours(original_contour_image, vector<vector<Point>>{metrics.contour}, -1, Scalar(255), 1);
-            drawContours(hull_contour_image, vector<vector<Point>>{metrics.hull}, -1, Scalar(255), 1);
+            drawContours(original_contour_image, vector<vector<Point>>{metrics.contour.to_vector()}, -1, Scalar(255), 1);
+            drawContours(hull_contour_image, vector<vector<Point>>{metrics.hull.to_vector()}, -1, Scalar(255), 1);
 
             imshow("Original Contour - " + img_path.filename().string(), original_contour_image);
             imshow("Convex Hull - " + img_path.filename().string(), hull_contour_image);
             waitKey(0);
             destroyAllWindows();
         } else {
-            cout << "No contours found for this image." << endl;
+            cout << "No contours found for " << img_path.filename() << "." << endl;
         }
     }
 
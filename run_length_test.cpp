@@ -0,0 +1,130 @@
+#include <opencv2/opencv.hpp>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "droplet_engine/contour_metrics.hpp"
+#include "droplet_engine/run_length.hpp"
+
+using namespace cv;
+using namespace std;
+
+// arcLength 以 float 累加每一段的長度，measure_blob 以整數步數乘 sqrt(2)，其餘量都是整數座標算出的值；
+// 兩者的相對誤差上限
+const double kTolerance = 1e-6;
+
+bool close_enough(double a, double b) {
+    return std::abs(a - b) <= kTolerance * std::max(1.0, std::max(std::abs(a), std::abs(b)));
+}
+
+// 以 (cx, cy) 為中心、半徑隨角度起伏的液滴（amplitude > 0 時凹），可再挖幾個圓洞
+void draw_droplet(mt19937& rng, Mat& mask, int lobes, double amplitude, int holes) {
+    double cx = mask.cols * 0.5, cy = mask.rows * 0.5;
+    double radius = std::min(mask.cols, mask.rows) * 0.3;
+    double phase = (rng() % 628) / 100.0;
+    for (int y = 0; y < mask.rows; ++y) {
+        for (int x = 0; x < mask.cols; ++x) {
+            double dx = x - cx, dy = y - cy;
+            double r = radius * (1 + amplitude * std::sin(lobes * std::atan2(dy, dx) + phase));
+            mask.at<uchar>(y, x) = dx * dx + dy * dy <= r * r ? 255 : 0;
+        }
+    }
+    for (int h = 0; h < holes; ++h) {
+        int hx = (int)(cx + (int)(rng() % 21) - 10), hy = (int)(cy + (int)(rng() % 21) - 10);
+        int hr = 1 + (int)(rng() % 3);
+        for (int y = std::max(0, hy - hr); y <= std::min(mask.rows - 1, hy + hr); ++y) {
+            for (int x = std::max(0, hx - hr); x <= std::min(mask.cols - 1, hx + hr); ++x) {
+                if ((x - hx) * (x - hx) + (y - hy) * (y - hy) <= hr * hr) {
+                    mask.at<uchar>(y, x) = 0;
+                }
+            }
+        }
+    }
+}
+
+// 隨機雜訊：大量不規則的小 blob，多數列中有數段 run
+void draw_noise(mt19937& rng, Mat& mask) {
+    for (int y = 0; y < mask.rows; ++y) {
+        for (int x = 0; x < mask.cols; ++x) {
+            mask.at<uchar>(y, x) = rng() % 100 < 55 ? 255 : 0;
+        }
+    }
+}
+
+// 每個 blob 單獨畫進外圍補 1 像素 0 的影像，以 findContours + calculate_contour_metrics 量測後與 measure_blob 比較
+bool check_blobs(const Mat& mask, const string& name, int& blobs, int& multi_run, int& mismatches) {
+    droplet::MetricsOptions options;
+    options.reject_degenerate = true;
+
+    droplet::RunLengthMask runs = droplet::RunLengthMask::from_mat(mask);
+    droplet::BlobLabels labels;
+    droplet::label_runs(runs, labels);
+
+    bool ok = true;
+    for (int b = 0; b < (int)labels.blobs.size(); ++b) {
+        Mat alone;
+        droplet::render_blob(runs, labels, b, Rect(-1, -1, mask.cols + 2, mask.rows + 2), alone);
+        vector<vector<Point>> contours;
+        findContours(alone, contours, RETR_EXTERNAL, CHAIN_APPROX_NONE);
+        droplet::ContourMetrics expected = droplet::calculate_contour_metrics(contours, options);
+        droplet::ContourMetrics actual = droplet::measure_blob(runs, labels, b, options);
+
+        bool same = contours.size() == 1 && expected.status == actual.status;
+        if (same && expected.ok()) {
+            same = close_enough(actual.area_original, expected.area_original) &&
+                   close_enough(actual.area_hull, expected.area_hull) &&
+                   close_enough(actual.circularity_original, expected.circularity_original) &&
+                   close_enough(actual.circularity_hull, expected.circularity_hull) &&
+                   actual.contour.size() == expected.contour.size();
+        }
+        if (!same) {
+            ++mismatches;
+            ok = false;
+            cout << "  mismatch: " << name << " blob " << b << " (" << labels.blobs[b].area << " pixels"
+                 << (labels.blobs[b].single_run_rows ? "" : ", multi-run rows") << "): area "
+                 << actual.area_original << " vs " << expected.area_original << ", circularity "
+                 << actual.circularity_original << " vs " << expected.circularity_original << endl;
+        }
+        ++blobs;
+        multi_run += labels.blobs[b].single_run_rows ? 0 : 1;
+    }
+    return ok;
+}
+
+// measure_blob 與 findContours(RETR_EXTERNAL, CHAIN_APPROX_NONE) + calculate_contour_metrics 在 kTolerance 內相同：
+// 凸液滴、凹液滴（每列一段或數段 run）、有洞的液滴與雜訊
+bool check_measure_blob(mt19937& rng) {
+    int blobs = 0, multi_run = 0, mismatches = 0;
+    const vector<Size> sizes = { {9, 7}, {40, 40}, {97, 63} };
+    for (Size size : sizes) {
+        for (int lobes : { 0, 3, 5, 8 }) {
+            for (double amplitude : { 0.0, 0.2, 0.45 }) {
+                for (int holes : { 0, 2 }) {
+                    Mat mask(size, CV_8UC1);
+                    draw_droplet(rng, mask, lobes, lobes == 0 ? 0.0 : amplitude, holes);
+                    check_blobs(mask, "droplet", blobs, multi_run, mismatches);
+                }
+            }
+        }
+        Mat noise(size, CV_8UC1);
+        draw_noise(rng, noise);
+        check_blobs(noise, "noise", blobs, multi_run, mismatches);
+    }
+
+    bool ok = mismatches == 0 && multi_run > 0;
+    cout << (ok ? "PASS " : "FAIL ") << "measure_blob: " << mismatches << " / " << blobs << " mismatches ("
+         << multi_run << " blobs with multi-run rows), tolerance " << kTolerance << endl;
+    return ok;
+}
+
+int main() {
+    cv::utils::logging::setLogLevel(cv::utils::logging::LOG_LEVEL_ERROR);
+
+    mt19937 rng(20240614);
+    bool ok = true;
+    ok &= check_measure_blob(rng);
+
+    return ok ? 0 : 1;
+}
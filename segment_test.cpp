@@ -0,0 +1,209 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "droplet_engine/fused_segment.hpp"
+#include "droplet_engine/pipeline.hpp"
+#include "droplet_engine/run_length.hpp"
+
+using namespace cv;
+using namespace std;
+
+// 含 1、2 像素寬 / 高的影像，補邊的列與欄都會被檢查到
+const vector<Size> kSizes = { {1, 1}, {2, 1}, {1, 2}, {2, 2}, {4, 7}, {7, 4}, {17, 17}, {33, 9}, {64, 48} };
+const vector<double> kThresholds = { 0, 10, 10.5, 40 };
+
+// 較大影像中的 ROI，外圍也是隨機值：結果不可讀到 ROI 以外的像素
+Mat random_roi(mt19937& rng, Size size) {
+    Mat parent(size.height + 4, size.width + 6, CV_8UC1);
+    for (int y = 0; y < parent.rows; ++y) {
+        for (int x = 0; x < parent.cols; ++x) {
+            parent.at<uchar>(y, x) = (uchar)(rng() & 255);
+        }
+    }
+    return parent(Rect(3, 2, size.width, size.height));
+}
+
+// 背景隨機；影像多數像素比背景暗 thresh 左右，讓模糊後的差值常落在門檻附近
+void make_frame(mt19937& rng, Size size, double thresh, Mat& image, Mat& background) {
+    background = random_roi(rng, size);
+    image = random_roi(rng, size);
+    for (int y = 0; y < size.height; ++y) {
+        for (int x = 0; x < size.width; ++x) {
+            if (rng() % 4 != 0) {
+                int delta = (int)(rng() % 9) - 4;
+                image.at<uchar>(y, x) = saturate_cast<uchar>((float)(background.at<uchar>(y, x) - thresh + delta));
+            }
+        }
+    }
+}
+
+// 兩邊各自模糊（獨立影像，與 fused_segment 的補邊相同）、相減、二值化
+void reference_segment(const Mat& image, const Mat& background, int ksize, double thresh,
+                       Mat& blurred_image, Mat& blurred_background, Mat& binary) {
+    GaussianBlur(image, blurred_image, Size(ksize, ksize), 0, 0, BORDER_DEFAULT | BORDER_ISOLATED);
+    GaussianBlur(background, blurred_background, Size(ksize, ksize), 0, 0, BORDER_DEFAULT | BORDER_ISOLATED);
+    Mat bg_sub;
+    subtract(blurred_background, blurred_image, bg_sub);
+    threshold(bg_sub, binary, thresh, 255, THRESH_BINARY);
+}
+
+bool same(const Mat& a, const Mat& b) {
+    return a.size() == b.size() && (a.empty() || norm(a, b, NORM_INF) == 0);
+}
+
+// fused_segment（Mat 與 run-length 輸出）必須與三個 OpenCV 步驟逐位元相同
+bool check_fused(mt19937& rng) {
+    int cases = 0, mismatches = 0;
+    for (int ksize : { 3, 5 }) {
+        for (Size size : kSizes) {
+            for (double thresh : kThresholds) {
+                Mat image, background;
+                make_frame(rng, size, thresh, image, background);
+
+                Mat blurred_image, blurred_background, expected, binary, from_runs;
+                reference_segment(image, background, ksize, thresh, blurred_image, blurred_background, expected);
+                droplet::fused_segment(image, blurred_background, binary, ksize, thresh);
+                droplet::RunLengthMask runs;
+                droplet::fused_segment(image, blurred_background, runs, ksize, thresh);
+                runs.to_mat(from_runs);
+
+                mismatches += same(binary, expected) && same(from_runs, expected) ? 0 : 1;
+                ++cases;
+            }
+        }
+    }
+
+    bool ok = mismatches == 0;
+    cout << (ok ? "PASS " : "FAIL ") << "fused_segment: " << mismatches << " / " << cases << " mismatches" << endl;
+    return ok;
+}
+
+// segment(image, window) 與整張二值化後再裁切相同：視窗在內部、貼著各邊與角落、1x1 與整張
+bool check_windowed(mt19937& rng) {
+    const Size size(64, 48);
+    const vector<Rect> windows = {
+        Rect(0, 0, 64, 48), Rect(10, 7, 23, 19), Rect(0, 0, 1, 1), Rect(63, 47, 1, 1),
+        Rect(0, 12, 9, 20), Rect(50, 5, 14, 30), Rect(20, 0, 30, 2), Rect(5, 45, 40, 3), Rect(1, 1, 62, 46)
+    };
+
+    int cases = 0, mismatches = 0;
+    for (int ksize : { 3, 5 }) {
+        for (int mode = 0; mode < 3; ++mode) {
+            Mat image, background;
+            make_frame(rng, size, 10, image, background);
+            image = image.clone();
+            background = background.clone();
+
+            droplet::PipelineConfig config = droplet::PipelineConfig::open_close_flow();
+            config.blur_size = ksize;
+            config.fused_segment = mode == 0;
+            config.blur_difference = mode == 2;
+            droplet::DropletPipeline pipeline(config);
+            pipeline.set_background(background);
+
+            Mat full, blurred_image, blurred_background;
+            if (config.blur_difference) {
+                droplet::difference_segment(image, background, full, ksize, config.threshold);
+            } else {
+                reference_segment(image, background, ksize, config.threshold, blurred_image, blurred_background, full);
+            }
+            Mat whole;
+            pipeline.segment(image, whole);
+            mismatches += same(whole, full) ? 0 : 1;
+            ++cases;
+
+            for (const Rect& window : windows) {
+                Mat binary;
+                pipeline.segment(image, window, binary);
+                mismatches += same(binary, full(window)) ? 0 : 1;
+                ++cases;
+            }
+        }
+    }
+
+    bool ok = mismatches == 0;
+    cout << (ok ? "PASS " : "FAIL ") << "windowed segment: " << mismatches << " / " << cases << " mismatches" << endl;
+    return ok;
+}
+
+// difference_segment 只捨入一次：與參考結果不同的像素，參考流程的模糊差值必須是 t 或 t + 1
+bool check_difference(mt19937& rng) {
+    long long pixels = 0, differing = 0, out_of_bound = 0, runs_mismatch = 0;
+    for (int ksize : { 3, 5 }) {
+        for (Size size : kSizes) {
+            for (double thresh : kThresholds) {
+                Mat image, background;
+                make_frame(rng, size, thresh, image, background);
+
+                Mat blurred_image, blurred_background, expected, binary, from_runs;
+                reference_segment(image, background, ksize, thresh, blurred_image, blurred_background, expected);
+                droplet::difference_segment(image, background, binary, ksize, thresh);
+                droplet::RunLengthMask runs;
+                droplet::difference_segment(image, background, runs, ksize, thresh);
+                runs.to_mat(from_runs);
+                runs_mismatch += same(binary, from_runs) ? 0 : 1;
+
+                int t = cvFloor(thresh);
+                for (int y = 0; y < size.height; ++y) {
+                    for (int x = 0; x < size.width; ++x) {
+                        ++pixels;
+                        if (binary.at<uchar>(y, x) == expected.at<uchar>(y, x)) {
+                            continue;
+                        }
+                        ++differing;
+                        int d = blurred_background.at<uchar>(y, x) - blurred_image.at<uchar>(y, x);
+                        out_of_bound += (d == t || d == t + 1) ? 0 : 1;
+                    }
+                }
+            }
+        }
+    }
+
+    bool ok = out_of_bound == 0 && runs_mismatch == 0;
+    cout << (ok ? "PASS " : "FAIL ") << "difference_segment: " << differing << " / " << pixels
+         << " pixels differ from blur-both, " << out_of_bound << " outside 1 grey level of the threshold, "
+         << runs_mismatch << " run-length mismatches" << endl;
+    return ok;
+}
+
+// PipelineConfig::blur_difference 的 segment 就是 difference_segment（原始背景，不另外模糊）
+bool check_blur_difference_config(mt19937& rng) {
+    int mismatches = 0, cases = 0;
+    for (int ksize : { 3, 5 }) {
+        Mat image, background;
+        make_frame(rng, Size(64, 48), 10, image, background);
+
+        droplet::PipelineConfig config = droplet::PipelineConfig::open_close_flow();
+        config.blur_size = ksize;
+        config.blur_difference = true;
+        droplet::DropletPipeline pipeline(config);
+        pipeline.set_background(background);
+
+        Mat binary, expected;
+        pipeline.segment(image, binary);
+        droplet::difference_segment(image, background, expected, ksize, config.threshold);
+        mismatches += same(binary, expected) ? 0 : 1;
+        ++cases;
+    }
+
+    bool ok = mismatches == 0;
+    cout << (ok ? "PASS " : "FAIL ") << "PipelineConfig::blur_difference: " << mismatches << " / " << cases
+         << " mismatches" << endl;
+    return ok;
+}
+
+int main() {
+    cv::utils::logging::setLogLevel(cv::utils::logging::LOG_LEVEL_ERROR);
+
+    mt19937 rng(20240611);
+    bool ok = true;
+    ok &= check_fused(rng);
+    ok &= check_windowed(rng);
+    ok &= check_difference(rng);
+    ok &= check_blur_difference_config(rng);
+
+    return ok ? 0 : 1;
+}
@@ -5,111 +5,106 @@
 #include <filesystem>
 #include <chrono>
 #include <thread>
-#include <queue>
-#include <mutex>
-#include <condition_variable>
+#include <atomic>
+#include <algorithm>
 #include <numeric>
+#include <utility>
+
+#include "droplet_engine/channel.hpp"
+#include "droplet_engine/ordered_sink.hpp"
+#include "droplet_engine/pipeline.hpp"
+#include "droplet_engine/threading_policy.hpp"
 
 namespace fs = std::filesystem;
 
 struct ImageData {
     cv::Mat image;
     std::string name;
+    size_t index = 0;   // 讀檔順序，多個 worker 之後用來重新排序
 };
 
 struct ContourData {
     std::vector<std::vector<cv::Point>> contours;
     std::string name;
+    size_t index = 0;
 };
 
-struct ThreadSafeQueue {
-    std::queue<ImageData> queue;
-    std::mutex mutex;
-    std::condition_variable cond;
-
-    void push(ImageData&& data) {
-        std::lock_guard<std::mutex> lock(mutex);
-        queue.push(std::move(data));
-        cond.notify_one();
-    }
-
-    bool pop(ImageData& data) {
-        std::unique_lock<std::mutex> lock(mutex);
-        cond.wait(lock, [this] { return !queue.empty(); });
-        if (queue.empty()) return false;
-        data = std::move(queue.front());
-        queue.pop();
-        return true;
-    }
+struct FrameOutput {
+    std::string name;
+    bool found = false;
+    // 點由結果自己持有（shared storage），在通道與重排緩衝間移動不複製
+    droplet::ContourMetrics metrics;
+    double processing_time = 0;
 };
 
+// 每段之間最多暫存的影像數；解碼比處理快時讀檔端會等待，記憶體不隨影像數成長
+const size_t kChannelCapacity = 8;
+
 cv::Mat load_image(const std::string& image_path) {
     return cv::imread(image_path, cv::IMREAD_GRAYSCALE);
 }
 
-cv::Mat process_image(const cv::Mat& image, const cv::Mat& blurred_bg) {
-    cv::Mat blurred, bg_sub, binary, dilate1, erode1, erode2, dilate2;
-    cv::GaussianBlur(image, blurred, cv::Size(5, 5), 0);
-    cv::subtract(blurred_bg, blurred, bg_sub);
-    cv::threshold(bg_sub, binary, 10, 255, cv::THRESH_BINARY);
-    cv::Mat kernel = cv::getStructuringElement(cv::MORPH_CROSS, cv::Size(3, 3));
-    cv::dilate(binary, dilate1, kernel, cv::Point(-1, -1), 2);
-    cv::erode(dilate1, erode1, kernel, cv::Point(-1, -1), 2);
-    cv::erode(erode1, erode2, kernel, cv::Point(-1, -1), 1);
-    cv::dilate(erode2, dilate2, kernel, cv::Point(-1, -1), 1);
-    return dilate2;
+cv::Mat process_image(const cv::Mat& image, const droplet::DropletPipeline& pipeline) {
+    cv::Mat binary, cleaned;
+    pipeline.segment(image, binary);
+    pipeline.clean(binary, cleaned);
+    return cleaned;
 }
 
-std::vector<std::vector<cv::Point>> find_contours(const cv::Mat& processed_image) {
+std::vector<std::vector<cv::Point>> find_contours(const cv::Mat& processed_image, const droplet::DropletPipeline& pipeline) {
     cv::Mat edges;
     std::vector<std::vector<cv::Point>> contours;
-    cv::Canny(processed_image, edges, 50, 150);
-    cv::findContours(edges, contours, cv::RETR_LIST, cv::CHAIN_APPROX_SIMPLE);
+    pipeline.extract_edges(processed_image, edges);
+    pipeline.find_contours(edges, contours);
     return contours;
 }
 
-void worker_load(const std::vector<std::string>& image_paths, ThreadSafeQueue& output_queue) {
+// 讀檔端送出第 index 張前先等重排視窗有位置：後面的影像先處理完也只會停在視窗內，
+// 主執行緒的 submit 不會等待，下游通道一定會被取空
+void worker_load(const std::vector<std::string>& image_paths, droplet::MpmcChannel<ImageData>& output_channel,
+                 const droplet::OrderedSink<FrameOutput>& sink) {
+    size_t index = 0;
     for (const auto& path : image_paths) {
         cv::Mat image = load_image(path);
-        output_queue.push({image, fs::path(path).filename().string()});
+        if (image.empty()) {
+            continue;
+        }
+        sink.wait_for_slot(index);
+        if (!output_channel.push({image, fs::path(path).filename().string(), index++})) {
+            break;
+        }
     }
-    output_queue.push({cv::Mat(), ""});  // Sentinel
+    output_channel.close();
 }
 
-void worker_process(ThreadSafeQueue& input_queue, ThreadSafeQueue& output_queue, const cv::Mat& blurred_bg) {
+void worker_process(droplet::MpmcChannel<ImageData>& input_channel, droplet::MpmcChannel<ImageData>& output_channel, const droplet::DropletPipeline& pipeline, std::atomic<int>& running) {
+    // 多個形態學 worker 同時處理不同影像，影像內部不再平行
+    droplet::FrameParallelScope scope;
     ImageData data;
-    while (input_queue.pop(data) && !data.image.empty()) {
-        cv::Mat processed = process_image(data.image, blurred_bg);
-        output_queue.push({processed, data.name});
+    while (input_channel.pop(data)) {
+        cv::Mat processed = process_image(data.image, pipeline);
+        output_channel.push({processed, data.name, data.index});
+    }
+    // 最後一個離開的 worker 關閉下游
+    if (--running == 0) {
+        output_channel.close();
     }
-    output_queue.push({cv::Mat(), ""});  // Sentinel
 }
 
-void worker_contour(ThreadSafeQueue& input_queue, std::queue<ContourData>& output_queue, std::mutex& output_mutex, std::condition_variable& output_cond) {
+void worker_contour(droplet::MpmcChannel<ImageData>& input_channel, droplet::SpscChannel<ContourData>& output_channel, const droplet::DropletPipeline& pipeline) {
     ImageData data;
-    while (input_queue.pop(data) && !data.image.empty()) {
-        auto contours = find_contours(data.image);
-        {
-            std::lock_guard<std::mutex> lock(output_mutex);
-            output_queue.push({contours, data.name});
-        }
-        output_cond.notify_one();
+    while (input_channel.pop(data)) {
+        auto contours = find_contours(data.image, pipeline);
+        output_channel.push({contours, data.name, data.index});
     }
-    {
-        std::lock_guard<std::mutex> lock(output_mutex);
-        output_queue.push({{}, ""});  // Sentinel
-    }
-    output_cond.notify_one();
-}
-
-double calculate_circularity(const std::vector<cv::Point>& contour) {
-    double area = cv::contourArea(contour);
-    double perimeter = cv::arcLength(contour, true);
-    return 4 * CV_PI * area / (perimeter * perimeter);
+    output_channel.close();
 }
 
 int main() {
     cv::utils::logging::setLogLevel(cv::utils::logging::LOG_LEVEL_ERROR);
+    // OpenCV 的 parallel_for_ 交給共用的 pool；跨影像平行時影像內部依序執行，不會巢狀開執行緒
+    droplet::install_opencv_backend();
+
     std::string directory = "Test_images/Slight under focus";
     std::string background_path = directory + "/background.tiff";
 
@@ -121,60 +116,76 @@ int main() {
     }
 
     cv::Mat background = load_image(background_path);
-    cv::Mat blurred_bg;
-    cv::GaussianBlur(background, blurred_bg, cv::Size(5, 5), 0);
-
-    std::vector<ThreadSafeQueue> queues(3);
-    std::queue<ContourData> contour_queue;
-    std::mutex contour_mutex;
-    std::condition_variable contour_cond;
+    droplet::PipelineConfig config = droplet::PipelineConfig::linear_flow();
+    config.chain_approx = cv::CHAIN_APPROX_SIMPLE;
+    config.metrics.reject_degenerate = false;
+    droplet::DropletPipeline pipeline(config);
+    pipeline.set_background(background);
 
-    std::thread t1(worker_load, std::ref(image_paths), std::ref(queues[1]));
-    std::thread t2(worker_process, std::ref(queues[1]), std::ref(queues[2]), std::ref(blurred_bg));
-    std::thread t3(worker_contour, std::ref(queues[2]), std::ref(contour_queue), std::ref(contour_mutex), std::ref(contour_cond));
+    // 讀檔 -> 形態學（多個 worker）-> 輪廓 -> 指標，各段以固定容量的環形通道相接
+    droplet::MpmcChannel<ImageData> image_channel(kChannelCapacity);
+    droplet::MpmcChannel<ImageData> processed_channel(kChannelCapacity);
+    droplet::SpscChannel<ContourData> contour_channel(kChannelCapacity);
 
-    auto start_time = std::chrono::high_resolution_clock::now();
+    int process_workers = std::max(1, (int)std::thread::hardware_concurrency() - 3);
+    std::atomic<int> running_process(process_workers);
 
-    t1.join();
-    t2.join();
-    t3.join();
-
-    std::vector<std::tuple<std::string, std::vector<cv::Point>, double, double, double>> results;
     std::vector<double> processing_times;
-    ContourData contour_data;
-
-    while (true) {
-        std::unique_lock<std::mutex> lock(contour_mutex);
-        contour_cond.wait(lock, [&contour_queue] { return !contour_queue.empty(); });
-        contour_data = std::move(contour_queue.front());
-        contour_queue.pop();
-        lock.unlock();
-
-        if (contour_data.name.empty()) break;
-
-        auto start_time = std::chrono::high_resolution_clock::now();
-
-        if (!contour_data.contours.empty()) {
-            auto largest_contour = *std::max_element(contour_data.contours.begin(), contour_data.contours.end(),
-                [](const std::vector<cv::Point>& c1, const std::vector<cv::Point>& c2) {
-                    return cv::contourArea(c1) < cv::contourArea(c2);
-                });
-
-            std::vector<cv::Point> hull;
-            cv::convexHull(largest_contour, hull);
-
-            double circularity = calculate_circularity(largest_contour);
-            double hull_circularity = calculate_circularity(hull);
+    // 讀檔端依重排視窗節流（worker_load），視窗大小只影響能超前多少張，不影響正確性
+    size_t reorder_window = 4 * kChannelCapacity + process_workers + 4;
+    droplet::OrderedSink<FrameOutput> sink(reorder_window, [&](size_t, FrameOutput& output) {
+        if (!output.found) {
+            return;
+        }
+        processing_times.push_back(output.processing_time);
+        std::cout << "Image: " << output.name << std::endl;
+        std::cout << "Processing time: " << output.processing_time << " seconds" << std::endl;
+        std::cout << "Circularity: " << output.metrics.circularity_original << std::endl;
+        std::cout << "Hull Circularity: " << output.metrics.circularity_hull << std::endl;
+        std::cout << "Circularity Ratio: " << output.metrics.circularity_hull / output.metrics.circularity_original << std::endl;
+        std::cout << "Contour Points: ";
+        for (const auto& point : output.metrics.contour) {
+            std::cout << "(" << point.x << ", " << point.y << ") ";
+        }
+        std::cout << std::endl << std::endl;
+    });
 
-            auto end_time = std::chrono::high_resolution_clock::now();
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
-            double processing_time = duration.count() / 1e6;
-            processing_times.push_back(processing_time);
+    auto start_time = std::chrono::high_resolution_clock::now();
 
-            results.push_back(std::make_tuple(contour_data.name, largest_contour, circularity, hull_circularity, processing_time));
+    std::thread t1(worker_load, std::cref(image_paths), std::ref(image_channel), std::cref(sink));
+    std::vector<std::thread> process_threads;
+    for (int i = 0; i < process_workers; ++i) {
+        process_threads.emplace_back(worker_process, std::ref(image_channel), std::ref(processed_channel), std::cref(pipeline), std::ref(running_process));
+    }
+    std::thread t3(worker_contour, std::ref(processed_channel), std::ref(contour_channel), std::cref(pipeline));
+
+    std::vector<ContourData> batch;
+
+    // 通道有容量上限，必須邊跑邊取；結果依讀檔順序一到就輸出
+    while (contour_channel.pop_batch(batch, kChannelCapacity)) {
+        for (ContourData& contour_data : batch) {
+            auto start_time = std::chrono::high_resolution_clock::now();
+
+            FrameOutput output;
+            output.name = contour_data.name;
+            if (!contour_data.contours.empty()) {
+                output.metrics = droplet::calculate_contour_metrics(contour_data.contours, config.metrics);
+                output.found = true;
+
+                auto end_time = std::chrono::high_resolution_clock::now();
+                auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+                output.processing_time = duration.count() / 1e6;
+            }
+            sink.submit(contour_data.index, std::move(output));
         }
     }
 
+    t1.join();
+    for (std::thread& t : process_threads) {
+        t.join();
+    }
+    t3.join();
+
     auto end_time = std::chrono::high_resolution_clock::now();
     auto total_duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
 
@@ -183,18 +194,5 @@ int main() {
     double avg_processing_time = std::accumulate(processing_times.begin(), processing_times.end(), 0.0) / processing_times.size();
     std::cout << "Average processing time per image: " << avg_processing_time << " seconds" << std::endl;
 
-    for (const auto& [name, contour, circularity, hull_circularity, processing_time] : results) {
-        std::cout << "Image: " << name << std::endl;
-        std::cout << "Processing time: " << processing_time << " seconds" << std::endl;
-        std::cout << "Circularity: " << circularity << std::endl;
-        std::cout << "Hull Circularity: " << hull_circularity << std::endl;
-        std::cout << "Circularity Ratio: " << hull_circularity / circularity << std::endl;
-        std::cout << "Contour Points: ";
-        for (const auto& point : contour) {
-            std::cout << "(" << point.x << ", " << point.y << ") ";
-        }
-        std::cout << std::endl << std::endl;
-    }
-
     return 0;
 }